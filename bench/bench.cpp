@@ -1,39 +1,596 @@
+#include <atomic>
+#include <fcntl.h>
 #include <iostream>
 #include <thread>
 #include <vector>
 #include <chrono>
 #include "ring_buffer/ring_buffer.hpp"
+#include "ring_buffer/thread_pool.hpp"
+#include "ring_buffer/numa.hpp"
+#include "ring_buffer/compact_ring_buffer.hpp"
+#include "ring_buffer/batching_producer.hpp"
+#include "ring_buffer/partitioned_channel.hpp"
+#include "ring_buffer/async_logger.hpp"
+#include "ring_buffer/file_sink.hpp"
+#include "ring_buffer/traffic_trace.hpp"
+#include "ring_buffer/residence.hpp"
 
 using hiresclock_t = std::chrono::high_resolution_clock;
 
-int main() {
-    constexpr std::size_t N = 5'000'000;
-    rb::SpscRingBuffer<uint64_t, 1 << 14> q;
+static void pin(int cpu) {
+    if (cpu >= 0) {
+        rb::pin_current_thread(static_cast<unsigned>(cpu));
+    }
+}
 
+// Items per microsecond moving n integers from a producer on prod_cpu to a consumer on cons_cpu.
+template <class Ring>
+static double throughput_mops(Ring& q, std::size_t n, int prod_cpu, int cons_cpu) {
     auto t0 = hiresclock_t::now();
     std::thread prod([&] {
-        for (std::size_t i = 0; i < N; ++i) {
+        pin(prod_cpu);
+        for (std::size_t i = 0; i < n; ++i) {
             while (!q.emplace(i)) {
                 std::this_thread::yield();
             }
         }
     });
-
     std::thread cons([&] {
+        pin(cons_cpu);
         std::size_t seen = 0;
         uint64_t v;
-        while (seen < N) {
+        while (seen < n) {
             if (q.pop(v)) {
                 ++seen;
+            } else {
+                std::this_thread::yield();
             }
         }
     });
+    prod.join();
+    cons.join();
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(hiresclock_t::now() - t0).count();
+    return (double)n / (double)(us ? us : 1);
+}
 
+// Items per microsecond for Bytes-sized payloads, the consumer reading every word.
+template <std::size_t Bytes, rb::StorePolicy Store>
+static double payload_mops(std::size_t n) {
+    struct Payload {
+        uint64_t words[Bytes / 8];
+    };
+    auto q = rb::numa::make_ring<rb::SpscRingBuffer<Payload, 4096, Store>>(rb::numa::Placement{});
+    if (!q) {
+        return 0;
+    }
+    auto t0 = hiresclock_t::now();
+    std::thread prod([&] {
+        Payload p{};
+        for (std::size_t i = 0; i < n; ++i) {
+            p.words[0] = i;
+            while (!q->push(p)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    std::thread cons([&] {
+        Payload p;
+        uint64_t sum = 0;
+        for (std::size_t seen = 0; seen < n;) {
+            if (q->pop(p)) {
+                for (auto w : p.words) {
+                    sum += w;
+                }
+                ++seen;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        volatile uint64_t sink = sum;
+        (void)sink;
+    });
     prod.join();
     cons.join();
-    auto t1 = hiresclock_t::now();
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
-    double mops = (double)N / (double)ms / 1000.0;
-    std::cout << "Transferred " << N << " items in " << ms << " ms (" << mops << " Mops)\n";
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(hiresclock_t::now() - t0).count();
+    return (double)n / (double)(us ? us : 1);
+}
+
+template <std::size_t Bytes>
+static void report_store_policies(std::size_t n) {
+    const double regular = payload_mops<Bytes, rb::StorePolicy::regular>(n);
+    const double streaming = payload_mops<Bytes, rb::StorePolicy::streaming>(n);
+    const double demote = payload_mops<Bytes, rb::StorePolicy::demote>(n);
+    std::cout << Bytes << " B elements: regular " << regular << ", streaming " << streaming << ", demote " << demote
+              << " Mops -> " << (streaming > regular && streaming >= demote ? "streaming"
+                                 : demote > regular                         ? "demote"
+                                                                            : "regular")
+              << " wins\n";
+}
+
+// Items per microsecond drained with pop_bulk from a ring of Slots Bytes-sized
+// elements, prefetching `lines` cache lines ahead.
+template <std::size_t Bytes, std::size_t Slots>
+static double prefetch_mops(std::size_t n, std::size_t lines) {
+    struct Payload {
+        uint64_t words[Bytes / 8];
+    };
+    auto q = rb::numa::make_ring<rb::SpscRingBuffer<Payload, Slots>>(rb::numa::Placement{});
+    if (!q) {
+        return 0;
+    }
+    q->set_prefetch_distance(lines);
+    auto t0 = hiresclock_t::now();
+    std::thread prod([&] {
+        Payload p{};
+        for (std::size_t i = 0; i < n; ++i) {
+            p.words[0] = i;
+            while (!q->push(p)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    std::thread cons([&] {
+        std::vector<Payload> batch(256);
+        uint64_t sum = 0;
+        for (std::size_t seen = 0; seen < n;) {
+            const std::size_t got = q->pop_bulk(batch.data(), batch.size());
+            for (std::size_t i = 0; i < got; ++i) {
+                sum += batch[i].words[0];
+            }
+            seen += got;
+            if (got == 0) {
+                std::this_thread::yield();
+            }
+        }
+        volatile uint64_t sink = sum;
+        (void)sink;
+    });
+    prod.join();
+    cons.join();
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(hiresclock_t::now() - t0).count();
+    return (double)n / (double)(us ? us : 1);
+}
+
+template <std::size_t Bytes, std::size_t Slots>
+static void sweep_prefetch(std::size_t n) {
+    std::cout << "Prefetch " << Bytes << " B x " << Slots << " slots:";
+    for (std::size_t lines : {0u, 2u, 4u, 8u, 16u}) {
+        std::cout << " d=" << lines << " " << prefetch_mops<Bytes, Slots>(n, lines);
+    }
+    std::cout << " Mops\n";
+}
+
+// Mean one-way latency in ns, measured as half a ping-pong round trip over two rings.
+template <class Ring>
+static double pingpong_ns(Ring& ping, Ring& pong, std::size_t rounds, int prod_cpu, int cons_cpu) {
+    std::thread echo([&] {
+        pin(cons_cpu);
+        uint64_t v;
+        for (std::size_t i = 0; i < rounds; ++i) {
+            while (!ping.pop(v)) {
+                std::this_thread::yield();
+            }
+            while (!pong.emplace(v)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    double ns = 0;
+    std::thread driver([&] {
+        pin(prod_cpu);
+        uint64_t v;
+        auto t0 = hiresclock_t::now();
+        for (std::size_t i = 0; i < rounds; ++i) {
+            while (!ping.emplace(i)) {
+                std::this_thread::yield();
+            }
+            while (!pong.pop(v)) {
+                std::this_thread::yield();
+            }
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(hiresclock_t::now() - t0).count();
+        ns = (double)elapsed / (double)rounds / 2.0;
+    });
+    echo.join();
+    driver.join();
+    return ns;
+}
+
+// Items per microsecond through a PartitionedChannel with one consumer per
+// partition, each doing a little per-item work so the fan-out can scale.
+template <std::size_t Partitions>
+static double partitioned_mops(std::size_t n) {
+    auto key = [](const uint64_t& v) { return v; };
+    rb::PartitionedChannel<uint64_t, Partitions, decltype(key)> ch(key);
+    std::atomic<std::size_t> consumed{0};
+    auto t0 = hiresclock_t::now();
+    std::vector<std::thread> consumers;
+    for (std::size_t p = 0; p < Partitions; ++p) {
+        consumers.emplace_back([&, p] {
+            uint64_t batch[64];
+            uint64_t sink = 0;
+            while (consumed.load(std::memory_order_relaxed) < n) {
+                const std::size_t got = ch.partition(p).pop_bulk(batch, 64);
+                for (std::size_t i = 0; i < got; ++i) {
+                    uint64_t x = batch[i];
+                    for (int r = 0; r < 32; ++r) {
+                        x = x * 6364136223846793005ull + 1442695040888963407ull;
+                    }
+                    sink += x;
+                }
+                if (got == 0) {
+                    std::this_thread::yield();
+                } else {
+                    consumed.fetch_add(got, std::memory_order_relaxed);
+                }
+            }
+            volatile uint64_t keep = sink;
+            (void)keep;
+        });
+    }
+    uint64_t batch[64];
+    for (std::size_t i = 0; i < n;) {
+        const std::size_t len = n - i < 64 ? n - i : 64;
+        for (std::size_t j = 0; j < len; ++j) {
+            batch[j] = i + j;
+        }
+        std::size_t done = 0;
+        while (done < len) {
+            done += ch.push_bulk(batch + done, batch + len);
+            if (done < len) {
+                std::this_thread::yield();
+            }
+        }
+        i += len;
+    }
+    for (auto& t : consumers) {
+        t.join();
+    }
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(hiresclock_t::now() - t0).count();
+    return (double)n / (double)(us ? us : 1);
+}
+
+// GB/s journaling n 256-byte records from a ring to a scratch file through FileSink.
+static double journal_gbps(std::size_t n, bool uring, bool* used_uring) {
+    struct Rec {
+        uint64_t words[32];
+    };
+    using ring_t = rb::SpscRingBuffer<Rec, 1 << 14>;
+    char path[] = "/tmp/rb_journal_XXXXXX";
+    const int fd = ::mkstemp(path);
+    if (fd < 0) {
+        return 0;
+    }
+    ::unlink(path);
+    auto q = rb::numa::make_ring<ring_t>(rb::numa::Placement{}, rb::no_zero_init);
+    if (!q) {
+        ::close(fd);
+        return 0;
+    }
+    typename rb::FileSink<ring_t>::Options opts;
+    opts.use_io_uring = uring;
+    std::atomic<bool> failed{false};
+    auto t0 = hiresclock_t::now();
+    std::thread prod([&] {
+        Rec r{};
+        for (std::size_t i = 0; i < n; ++i) {
+            r.words[0] = i;
+            while (!q->push(r)) {
+                if (failed.load(std::memory_order_relaxed)) {
+                    return;
+                }
+                std::this_thread::yield();
+            }
+        }
+    });
+    {
+        rb::FileSink<ring_t> sink(*q, fd, opts);
+        *used_uring = sink.using_io_uring();
+        while (sink.bytes_written() < n * sizeof(Rec)) {
+            if (!sink.poll()) {
+                failed.store(true, std::memory_order_relaxed);
+                break;
+            }
+            std::this_thread::yield(); // leave the core to the producer and the kernel's write workers
+        }
+        prod.join();
+        sink.flush();
+    }
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(hiresclock_t::now() - t0).count();
+    ::close(fd);
+    return (double)(n * sizeof(Rec)) / (double)(us ? us : 1) / 1000.0;
+}
+
+// Replays trace through a Ring (push()/pop() of TracedMsg) and prints the
+// enqueue-to-dequeue latency distribution.
+struct TracedMsg {
+    uint64_t stamp;
+    uint32_t size;
+};
+
+template <class Ring>
+static void replay_latency(const char* name, const rb::Trace& trace) {
+    auto q = std::make_unique<Ring>();
+    rb::LatencyHistogram hist;
+    std::thread cons([&] {
+        TracedMsg m;
+        for (std::size_t seen = 0; seen < trace.size();) {
+            if (q->pop(m)) {
+                hist.record(rb::read_tsc() - m.stamp);
+                ++seen;
+            } else {
+                rb::cpu_relax();
+            }
+        }
+    });
+    const auto stats = rb::replay(trace, [&](const rb::TraceEvent& e) {
+        while (!q->push(TracedMsg{rb::read_tsc(), e.size})) {
+            rb::cpu_relax();
+        }
+    });
+    cons.join();
+    std::cout << name << ": p50 " << rb::tsc_to_ns(hist.percentile(0.5)) << " ns, p99 "
+              << rb::tsc_to_ns(hist.percentile(0.99)) << " ns, p99.9 " << rb::tsc_to_ns(hist.percentile(0.999))
+              << " ns, max " << rb::tsc_to_ns(hist.max()) << " ns; " << stats.late << " of " << stats.events
+              << " issued late (worst " << stats.max_late_ns << " ns)\n";
+}
+
+// Bursty stand-in for a captured trace: bursts of 1-64 back-to-back messages
+// 10-100 us apart, 32-512 bytes each.
+static rb::Trace synthetic_trace(std::size_t events) {
+    rb::Trace t;
+    uint64_t x = 88172645463325252ull;
+    auto next = [&x] {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        return x;
+    };
+    while (t.size() < events) {
+        const uint64_t burst = 1 + next() % 64;
+        t.append(10'000 + next() % 90'000, static_cast<uint32_t>(32 + next() % 481));
+        for (uint64_t i = 1; i < burst && t.size() < events; ++i) {
+            t.append(next() % 50, static_cast<uint32_t>(32 + next() % 481));
+        }
+    }
+    return t;
+}
+
+int main(int argc, char** argv) {
+    constexpr std::size_t N = 5'000'000;
+    {
+        rb::SpscRingBuffer<uint64_t, 1 << 14> q;
+
+        auto t0 = hiresclock_t::now();
+        std::thread prod([&] {
+            for (std::size_t i = 0; i < N; ++i) {
+                while (!q.emplace(i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        std::thread cons([&] {
+            std::size_t seen = 0;
+            uint64_t v;
+            while (seen < N) {
+                if (q.pop(v)) {
+                    ++seen;
+                }
+            }
+        });
+
+        prod.join();
+        cons.join();
+        auto t1 = hiresclock_t::now();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+        double mops = (double)N / (double)ms / 1000.0;
+        std::cout << "Transferred " << N << " items in " << ms << " ms (" << mops << " Mops)\n";
+    }
+
+    {
+        constexpr std::size_t Tasks = 1'000'000;
+        std::atomic<std::size_t> done{0};
+        double submit_ns = 0;
+        auto t0 = hiresclock_t::now();
+        {
+            rb::ThreadPool<1 << 14> pool(2);
+            auto s0 = hiresclock_t::now();
+            for (std::size_t i = 0; i < Tasks; ++i) {
+                pool.submit([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+            }
+            auto s1 = hiresclock_t::now();
+            submit_ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(s1 - s0).count() / (double)Tasks;
+        }
+        auto t1 = hiresclock_t::now();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+        std::cout << "ThreadPool ran " << done.load() << " tasks in " << ms << " ms (" << submit_ns << " ns/submit)\n";
+    }
+
+    {
+        // Every producer-node x consumer-node x memory-node combination, threads pinned
+        // to the first CPU of their node and the rings bound to the memory node.
+        using ring_t = rb::SpscRingBuffer<uint64_t, 1 << 14>;
+        const auto topo = rb::numa::Topology::detect();
+        auto first_cpu = [&](std::size_t i) { return topo.cpus[i].empty() ? -1 : topo.cpus[i].front(); };
+        for (std::size_t p = 0; p < topo.nodes.size(); ++p) {
+            for (std::size_t c = 0; c < topo.nodes.size(); ++c) {
+                for (std::size_t m = 0; m < topo.nodes.size(); ++m) {
+                    const auto where = rb::numa::Placement::on_node(topo.nodes[m]);
+                    auto q = rb::numa::make_ring<ring_t>(where);
+                    auto ping = rb::numa::make_ring<ring_t>(where);
+                    auto pong = rb::numa::make_ring<ring_t>(where);
+                    if (!q || !ping || !pong) {
+                        std::cout << "NUMA node " << topo.nodes[m] << ": mbind failed\n";
+                        continue;
+                    }
+                    const double mops = throughput_mops(*q, 2'000'000, first_cpu(p), first_cpu(c));
+                    const double lat = pingpong_ns(*ping, *pong, 100'000, first_cpu(p), first_cpu(c));
+                    std::cout << "NUMA producer=" << topo.nodes[p] << " consumer=" << topo.nodes[c]
+                              << " memory=" << topo.nodes[m] << ": " << mops << " Mops, " << lat << " ns one-way\n";
+                }
+            }
+        }
+    }
+
+    {
+        // Mask indexing (power-of-two capacity) vs. conditional-subtract wrap.
+        auto pow2 = rb::numa::make_ring<rb::SpscRingBuffer<uint64_t, 1 << 14>>(rb::numa::Placement{});
+        auto wrap = rb::numa::make_ring<rb::SpscRingBuffer<uint64_t, 12'000>>(rb::numa::Placement{});
+        if (pow2 && wrap) {
+            std::cout << "Capacity 16384 (mask): " << throughput_mops(*pow2, N, -1, -1) << " Mops\n";
+            std::cout << "Capacity 12000 (wrap): " << throughput_mops(*wrap, N, -1, -1) << " Mops\n";
+        }
+        std::cout << "600K-slot ring of uint64_t: " << sizeof(rb::SpscRingBuffer<uint64_t, 600'000>) / 1024
+                  << " KiB exact vs " << sizeof(rb::SpscRingBuffer<uint64_t, 1 << 20>) / 1024 << " KiB rounded up\n";
+    }
+
+    {
+        // Store policies by element size.
+        report_store_policies<64>(1'000'000);
+        report_store_policies<256>(500'000);
+        report_store_policies<1024>(200'000);
+    }
+
+    {
+        // Prefetch distance vs. element size, in an L2-resident and a larger-than-L2 ring.
+        sweep_prefetch<8, 4096>(2'000'000);
+        sweep_prefetch<8, 1 << 20>(2'000'000);
+        sweep_prefetch<64, 512>(1'000'000);
+        sweep_prefetch<64, 1 << 17>(1'000'000);
+        sweep_prefetch<256, 128>(500'000);
+        sweep_prefetch<256, 1 << 15>(500'000);
+    }
+
+    {
+        // Footprint per queue vs. throughput for small per-connection queues.
+        using full_t = rb::SpscRingBuffer<uint64_t, 8>;
+        using compact_t = rb::CompactSpscRingBuffer<uint64_t, 8, uint32_t, 0>;
+        using compact_padded_t = rb::CompactSpscRingBuffer<uint64_t, 8, uint32_t, 64>;
+        full_t full;
+        compact_t compact;
+        compact_padded_t compact_padded;
+        std::cout << "SpscRingBuffer<u64, 8>: " << sizeof(full_t) << " B/queue, "
+                  << throughput_mops(full, N / 5, -1, -1) << " Mops\n";
+        std::cout << "Compact<u64, 8, u32, 0>: " << sizeof(compact_t) << " B/queue, "
+                  << throughput_mops(compact, N / 5, -1, -1) << " Mops\n";
+        std::cout << "Compact<u64, 8, u32, 64>: " << sizeof(compact_padded_t) << " B/queue, "
+                  << throughput_mops(compact_padded, N / 5, -1, -1) << " Mops\n";
+    }
+
+    {
+        // First lap through fresh pages vs. steady state, with and without prefault().
+        using ring_t = rb::SpscRingBuffer<uint64_t, 1 << 20>;
+        auto lap_ns = [](ring_t& q) {
+            const std::size_t n = ring_t::capacity();
+            auto t0 = hiresclock_t::now();
+            for (std::size_t i = 0; i < n; ++i) {
+                q.emplace(i);
+            }
+            auto t1 = hiresclock_t::now();
+            uint64_t v;
+            while (q.pop(v)) {
+            }
+            return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() / (double)n;
+        };
+        for (bool prefault : {false, true}) {
+            auto q = rb::numa::make_ring<ring_t>(rb::numa::Placement{}, rb::no_zero_init);
+            if (!q) {
+                break;
+            }
+            if (prefault) {
+                q->prefault();
+                q->lock_memory();
+            }
+            const double first = lap_ns(*q);
+            const double steady = lap_ns(*q);
+            std::cout << (prefault ? "Prefaulted" : "Cold") << " ring: first lap " << first
+                      << " ns/emplace, steady " << steady << " ns/emplace\n";
+        }
+    }
+    {
+        // Head published per push vs. lazily by BatchingProducer.
+        using ring_t = rb::SpscRingBuffer<uint64_t, 4096>;
+        auto q = std::make_unique<ring_t>();
+        std::cout << "Per-push publication: " << throughput_mops(*q, N, -1, -1) << " Mops\n";
+        (void)rb::tsc_ticks_per_ns(); // calibrate (~10 ms) outside the timed region
+        auto t0 = hiresclock_t::now();
+        std::thread prod([&] {
+            rb::BatchingProducer<ring_t> bp(*q, 64);
+            for (std::size_t i = 0; i < N; ++i) {
+                while (!bp.emplace(i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        std::thread cons([&] {
+            uint64_t v;
+            for (std::size_t seen = 0; seen < N;) {
+                if (q->pop(v)) {
+                    ++seen;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        prod.join();
+        cons.join();
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(hiresclock_t::now() - t0).count();
+        std::cout << "BatchingProducer:     " << (double)N / (double)(us ? us : 1) << " Mops\n";
+    }
+    {
+        // Key-partitioned fan-out: 1 to 8 consumers.
+        std::cout << "Partitioned x1: " << partitioned_mops<1>(N / 5) << " Mops\n";
+        std::cout << "Partitioned x2: " << partitioned_mops<2>(N / 5) << " Mops\n";
+        std::cout << "Partitioned x4: " << partitioned_mops<4>(N / 5) << " Mops\n";
+        std::cout << "Partitioned x8: " << partitioned_mops<8>(N / 5) << " Mops\n";
+    }
+
+    {
+        // Async logger: cost of one log call on the hot thread against its 20 ns
+        // budget. Bursts stay below the ring size and the backend (polling every
+        // 1 ms) drains between them, so mostly the call itself is timed.
+        const int devnull = ::open("/dev/null", O_WRONLY);
+        {
+            rb::AsyncLogger<> logger({devnull, 64 * 1024, std::chrono::milliseconds(1)});
+            constexpr std::size_t Burst = 8192, Bursts = 200;
+            std::int64_t total_ns = 0;
+            for (std::size_t b = 0; b < Bursts; ++b) {
+                auto t0 = hiresclock_t::now();
+                for (std::size_t i = 0; i < Burst; ++i) {
+                    logger.log([] { return "order {} px {} qty {} side {}"; }, i, 101.25, 300u, 'B');
+                }
+                total_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(hiresclock_t::now() - t0).count();
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            const double per_call = (double)total_ns / (double)(Burst * Bursts);
+            std::cout << "AsyncLogger::log: " << per_call << " ns/call ("
+                      << (per_call < 20.0 ? "within" : "over") << " the 20 ns budget), dropped "
+                      << logger.dropped() << "\n";
+        }
+        ::close(devnull);
+    }
+
+    {
+        // Journaling 256 MB from a ring to a file: io_uring vs. pwritev fallback.
+        for (bool uring : {true, false}) {
+            bool used = false;
+            const double gbps = journal_gbps(1 << 20, uring, &used);
+            std::cout << "FileSink (" << (used ? "io_uring" : "pwritev") << "): " << gbps << " GB/s\n";
+        }
+    }
+
+    {
+        // Captured traffic (bench <trace-file>, written by TraceRecorder) or a
+        // synthetic bursty trace, replayed through several queue designs.
+        rb::Trace trace;
+        if (argc < 2 || !trace.load(argv[1])) {
+            trace = synthetic_trace(200'000);
+        }
+        std::cout << "Trace: " << trace.size() << " messages over " << (double)trace.duration_ns() / 1e6 << " ms\n";
+        replay_latency<rb::SpscRingBuffer<TracedMsg, 1024>>("SpscRingBuffer<1024>", trace);
+        replay_latency<rb::SpscRingBuffer<TracedMsg, 1000>>("SpscRingBuffer<1000>", trace);
+        replay_latency<rb::CompactSpscRingBuffer<TracedMsg, 1024>>("CompactSpscRingBuffer<1024>", trace);
+    }
     return 0;
 }
@@ -0,0 +1,440 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <unistd.h>
+#if __has_include(<format>)
+#include <format>
+#endif
+#include "ring_buffer/ring_buffer.hpp"
+#include "ring_buffer/tsc.hpp"
+
+// Asynchronous binary logger with deferred formatting.
+// Requirements:
+//  - Arguments are trivially copyable and fit in Record::ArgBytes together.
+//    Character pointers and string_views are stored as pointers, so they must
+//    refer to storage that outlives the logger (string literals, static tables).
+//  - The format string is returned by a captureless lambda, which gives every
+//    call site its own type and therefore its own format ID:
+//        logger.log([] { return "fill px {} qty {}"; }, px, qty);
+//    It is checked against the arguments at compile time: as a
+//    std::format_string where <format> exists, otherwise its "{}" fields must
+//    pair up and match the argument count. A record that still fails to format
+//    on the background thread is written as a "<format error: ...>" line.
+// The calling thread reserves one 64-byte record in its own SpscRingBuffer and
+// writes the format ID, a TSC stamp and the raw argument bytes into it: no
+// formatting, locking or allocation (after the thread's first call). A
+// background thread drains every thread's ring, formats each record (with
+// std::format where the standard library has it, otherwise a "{}"-only
+// formatter that ignores format specs) and write()s the text in large batches.
+// Each line is prefixed with the nanoseconds since the logger started; lines
+// from different threads are not ordered against each other. A full ring drops
+// the record and counts it in dropped(), as does a thread left without a ring
+// (MaxThreads reached or the allocation failed).
+
+namespace rb {
+
+namespace detail {
+
+inline void append_arg(std::string& out, bool v) {
+    out += v ? "true" : "false";
+}
+inline void append_arg(std::string& out, char v) {
+    out += v;
+}
+inline void append_arg(std::string& out, const char* v) {
+    out += v ? v : "(null)";
+}
+inline void append_arg(std::string& out, std::string_view v) {
+    out += v;
+}
+template <class V>
+void append_arg(std::string& out, const V& v) {
+    if constexpr (std::is_pointer_v<V>) {
+        char buf[2 + 16];
+        buf[0] = '0';
+        buf[1] = 'x';
+        const auto res = std::to_chars(buf + 2, buf + sizeof(buf), reinterpret_cast<std::uintptr_t>(v), 16);
+        out.append(buf, res.ptr);
+    } else {
+        static_assert(std::is_arithmetic_v<V>, "unsupported log argument type");
+        char buf[64];
+        const auto res = std::to_chars(buf, buf + sizeof(buf), v);
+        out.append(buf, res.ptr);
+    }
+}
+
+// Substitutes args for the "{}" fields of fmt in order; "{{" and "}}" are
+// literal braces and anything between the braces of a field is ignored.
+template <class... Args>
+void format_fallback(std::string& out, const char* fmt, const Args&... args) {
+    const std::size_t field_count = sizeof...(Args);
+    std::size_t field = 0;
+    auto append_field = [&](std::size_t want) {
+        std::size_t i = 0;
+        ((i++ == want ? append_arg(out, args) : void()), ...);
+    };
+    for (const char* p = fmt; *p; ++p) {
+        if ((p[0] == '{' && p[1] == '{') || (p[0] == '}' && p[1] == '}')) {
+            out += *p++;
+        } else if (*p == '{') {
+            while (p[1] && p[1] != '}') {
+                ++p;
+            }
+            if (p[1]) {
+                ++p;
+            }
+            if (field < field_count) {
+                append_field(field++);
+            }
+        } else {
+            out += *p;
+        }
+    }
+}
+
+// Enums print as their underlying value, character pointers as strings and
+// other pointers as addresses, whichever formatter is in use.
+template <class V>
+auto loggable(const V& v) noexcept {
+    if constexpr (std::is_enum_v<V>) {
+        return static_cast<std::underlying_type_t<V>>(v);
+    } else if constexpr (std::is_pointer_v<V> && std::is_same_v<std::remove_cv_t<std::remove_pointer_t<V>>, char>) {
+        return static_cast<const char*>(v);
+    } else if constexpr (std::is_pointer_v<V>) {
+        return static_cast<const void*>(v);
+    } else {
+        return v;
+    }
+}
+
+template <class V>
+using loggable_t = decltype(loggable(std::declval<const V&>()));
+
+// Replacement fields in fmt, or -1 if its braces do not pair up or a field
+// nests another (which the fallback formatter cannot handle).
+constexpr int count_format_fields(const char* fmt) noexcept {
+    int n = 0;
+    for (const char* p = fmt; *p; ++p) {
+        if ((p[0] == '{' && p[1] == '{') || (p[0] == '}' && p[1] == '}')) {
+            ++p;
+        } else if (*p == '}') {
+            return -1;
+        } else if (*p == '{') {
+            while (*++p != '}') {
+                if (*p == '\0' || *p == '{') {
+                    return -1;
+                }
+            }
+            ++n;
+        }
+    }
+    return n;
+}
+
+template <class... Args>
+void format_args(std::string& out, const char* fmt, const Args&... args) {
+#if defined(__cpp_lib_format)
+    std::vformat_to(std::back_inserter(out), fmt, std::make_format_args(args...));
+#else
+    format_fallback(out, fmt, args...);
+#endif
+}
+
+using log_decoder_t = void (*)(std::string& out, const char* fmt, const unsigned char* args);
+
+struct LogSite {
+    const char* fmt;
+    log_decoder_t decode;
+};
+
+inline constexpr std::size_t max_log_sites = 4096;
+inline std::array<LogSite, max_log_sites> log_sites{};
+inline std::atomic<std::uint32_t> log_site_count{0};
+
+template <class... Args>
+void decode_record(std::string& out, const char* fmt, const unsigned char* bytes) {
+    std::tuple<Args...> values;
+    std::size_t off = 0;
+    std::apply([&](auto&... v) { ((std::memcpy(&v, bytes + off, sizeof(v)), off += sizeof(v)), ...); }, values);
+    std::apply([&](const auto&... v) { format_args(out, fmt, loggable(v)...); }, values);
+}
+
+// Returns the new site's ID, or max_log_sites once the table is full.
+template <class... Args>
+std::uint32_t register_log_site(const char* fmt) noexcept {
+    const auto id = log_site_count.fetch_add(1, std::memory_order_relaxed);
+    if (id >= max_log_sites) {
+        return static_cast<std::uint32_t>(max_log_sites);
+    }
+    // Published to the background thread by the release that commits the first record.
+    log_sites[id] = LogSite{fmt, &decode_record<Args...>};
+    return id;
+}
+
+inline std::atomic<std::uint64_t> logger_instances{0};
+
+}
+
+template <std::size_t RingRecords = 16384, std::size_t MaxThreads = 64>
+class AsyncLogger {
+public:
+    struct alignas(64) Record {
+        static constexpr std::size_t ArgBytes = 48;
+        std::uint32_t site;
+        std::uint32_t pad;
+        std::uint64_t tsc;
+        unsigned char args[ArgBytes];
+    };
+    static_assert(sizeof(Record) == 64);
+
+    struct Options {
+        int fd = STDERR_FILENO;
+        // Formatted bytes buffered before a write(); the buffer is also written
+        // whenever the rings run dry.
+        std::size_t flush_bytes = 64 * 1024;
+        std::chrono::microseconds idle_sleep{100};
+    };
+
+    AsyncLogger() : AsyncLogger(Options{}) {}
+
+    explicit AsyncLogger(Options opts)
+        : opts(opts),
+          instance(detail::logger_instances.fetch_add(1, std::memory_order_relaxed) + 1),
+          start_tsc(read_tsc()),
+          ticks_per_ns(tsc_ticks_per_ns()),
+          backend([this] { run(); }) {}
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    // Drains every ring, writes the remaining text and stops the background thread.
+    ~AsyncLogger() {
+        stopping.store(true, std::memory_order_release);
+        backend.join();
+    }
+
+    // Hot path. Returns false if the record was dropped (ring full, too many
+    // threads or call sites, or no ring could be allocated for this thread).
+    template <class FmtFn, class... Args>
+    bool log(FmtFn, Args&&... args) noexcept {
+        static_assert(std::is_empty_v<FmtFn>, "pass the format string as a captureless lambda");
+        static_assert((std::is_trivially_copyable_v<std::decay_t<Args>> && ...),
+                      "log arguments must be trivially copyable");
+        static_assert((sizeof(std::decay_t<Args>) + ... + 0) <= Record::ArgBytes, "log arguments too large");
+#if defined(__cpp_lib_format)
+        (void)std::format_string<detail::loggable_t<std::decay_t<Args>>...>{FmtFn{}()};
+#else
+        static_assert(detail::count_format_fields(FmtFn{}()) == static_cast<int>(sizeof...(Args)),
+                      "format string fields do not match the log arguments");
+#endif
+        static const std::uint32_t site = detail::register_log_site<std::decay_t<Args>...>(FmtFn{}());
+
+        ThreadRing* tr = local_ring();
+        if (tr == nullptr) [[unlikely]] {
+            unattached_drops.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        const auto slots = tr->ring.reserve(1);
+        if (slots.size() == 0 || site >= detail::max_log_sites) [[unlikely]] {
+            tr->dropped.store(tr->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        Record& r = slots.first[0];
+        r.site = site;
+        r.tsc = read_tsc();
+        std::size_t off = 0;
+        ((store_arg(r.args + off, static_cast<std::decay_t<Args>>(args)), off += sizeof(std::decay_t<Args>)), ...);
+        tr->ring.commit(1);
+        return true;
+    }
+
+    // Records dropped so far across all threads.
+    [[nodiscard]] std::uint64_t dropped() const noexcept {
+        std::uint64_t n = unattached_drops.load(std::memory_order_relaxed);
+        const auto count = ring_count.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < count; ++i) {
+            n += rings[i]->dropped.load(std::memory_order_relaxed);
+        }
+        return n;
+    }
+
+private:
+    struct ThreadRing {
+        SpscRingBuffer<Record, RingRecords> ring{no_zero_init};
+        std::atomic<bool> owned{true};
+        std::atomic<std::uint64_t> dropped{0};
+    };
+
+    // Per-thread cache of the ring this thread writes to. Hands the ring back
+    // for reuse when the thread exits.
+    struct LocalCache {
+        std::uint64_t instance = 0;
+        ThreadRing* ring = nullptr;
+        std::shared_ptr<ThreadRing> keep;
+
+        ~LocalCache() {
+            if (keep) {
+                keep->owned.store(false, std::memory_order_release);
+            }
+        }
+    };
+
+    template <class V>
+    static void store_arg(unsigned char* dst, const V& v) noexcept {
+        std::memcpy(dst, &v, sizeof(V));
+    }
+
+    ThreadRing* local_ring() noexcept {
+        static thread_local LocalCache cache;
+        if (cache.instance == instance) [[likely]] {
+            return cache.ring;
+        }
+        return attach(cache);
+    }
+
+    // Cold path: claims a ring released by an exited thread or adds a new one.
+    // nullptr if there is none to claim and no room, or locking or allocating
+    // failed; the thread then stays detached from this logger, so its later
+    // calls count the drop without coming back here for the lock.
+    ThreadRing* attach(LocalCache& cache) noexcept {
+        try {
+            return attach_locked(cache);
+        } catch (...) {
+            if (cache.keep) {
+                cache.keep->owned.store(false, std::memory_order_release);
+                cache.keep.reset();
+            }
+            cache.ring = nullptr;
+            cache.instance = instance;
+            return nullptr;
+        }
+    }
+
+    ThreadRing* attach_locked(LocalCache& cache) {
+        std::lock_guard<std::mutex> lock(attach_mutex);
+        if (cache.keep) {
+            cache.keep->owned.store(false, std::memory_order_release);
+            cache.keep.reset(); // released even if the allocation below throws
+            cache.ring = nullptr;
+            cache.instance = 0;
+        }
+        std::shared_ptr<ThreadRing> found;
+        const auto count = ring_count.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < count && !found; ++i) {
+            bool expected = false;
+            if (rings[i]->owned.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                found = rings[i];
+            }
+        }
+        if (!found && count < MaxThreads) {
+            found = std::make_shared<ThreadRing>();
+            rings[count] = found;
+            ring_count.store(count + 1, std::memory_order_release);
+        }
+        cache.instance = instance;
+        cache.ring = found.get();
+        cache.keep = std::move(found);
+        return cache.ring;
+    }
+
+    // Formats everything currently in the rings into text; returns the record count.
+    std::size_t drain(std::string& text) {
+        std::size_t n = 0;
+        const auto count = ring_count.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < count; ++i) {
+            auto& ring = rings[i]->ring;
+            const auto spans = ring.read_spans();
+            for (const auto run : {spans.first, spans.second}) {
+                for (const Record& r : run) {
+                    append_line(text, r);
+                }
+            }
+            ring.release(spans.size());
+            n += spans.size();
+        }
+        return n;
+    }
+
+    void append_line(std::string& text, const Record& r) {
+        const auto ns = static_cast<std::uint64_t>(static_cast<double>(r.tsc - start_tsc) / ticks_per_ns);
+        char buf[24];
+        text += '[';
+        text.append(buf, std::to_chars(buf, buf + sizeof(buf), ns).ptr);
+        text += "] ";
+        const detail::LogSite& site = detail::log_sites[r.site];
+        const std::size_t start = text.size();
+        try {
+            site.decode(text, site.fmt, r.args);
+        } catch (const std::exception& e) { // e.g. std::format_error from a runtime width
+            text.resize(start);
+            text += "<format error: ";
+            text += e.what();
+            text += "> ";
+            text += site.fmt;
+        }
+        text += '\n';
+    }
+
+    void write_out(std::string& text) {
+        const char* p = text.data();
+        std::size_t left = text.size();
+        while (left != 0) {
+            const auto w = ::write(opts.fd, p, left);
+            if (w < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            p += w;
+            left -= static_cast<std::size_t>(w);
+        }
+        text.clear();
+    }
+
+    void run() {
+        std::string text;
+        text.reserve(opts.flush_bytes + 4096);
+        while (true) {
+            const bool stop = stopping.load(std::memory_order_acquire);
+            const std::size_t n = drain(text);
+            if (text.size() >= opts.flush_bytes || (n == 0 && !text.empty())) {
+                write_out(text);
+            }
+            if (n == 0) {
+                if (stop) {
+                    break;
+                }
+                std::this_thread::sleep_for(opts.idle_sleep);
+            }
+        }
+    }
+
+    const Options opts;
+    const std::uint64_t instance;
+    const std::uint64_t start_tsc;
+    const double ticks_per_ns;
+    std::mutex attach_mutex;
+    std::array<std::shared_ptr<ThreadRing>, MaxThreads> rings{};
+    std::atomic<std::size_t> ring_count{0};
+    std::atomic<std::uint64_t> unattached_drops{0}; // records from threads left without a ring
+    std::atomic<bool> stopping{false};
+    std::thread backend;
+};
+
+}
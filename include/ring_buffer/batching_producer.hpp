@@ -0,0 +1,118 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include "ring_buffer/ring_buffer.hpp"
+#include "ring_buffer/tsc.hpp"
+
+// Producer-side wrapper that publishes the ring's head lazily.
+// Requirements:
+//  - Ring provides stage()/publish()/cached_depth()/producer_depth() and a
+//    static capacity(), e.g. SpscRingBuffer.
+//  - The wrapper is the ring's only producer; nothing else may push while it
+//    holds staged elements.
+// Slots are written immediately, but head is release-stored only once the
+// current batch is full, on flush(), or once the oldest staged element has
+// waited longer than the deadline (checked every few pushes and by poll()).
+// The batch size adapts from the producer's cached tail. A flush reloads the
+// shared tail only once the next batch would not fit the cached view of free
+// space (stage() would have to reload it anyway): if the consumer still had
+// earlier elements outstanding the batch doubles (up to max_batch), if it had
+// caught up it halves towards 1, so a sparse stream is published element by
+// element.
+
+namespace rb {
+
+template <class Ring>
+class BatchingProducer {
+    // Pushes between deadline checks; reading the TSC on every push would cost
+    // as much as the coherence traffic the batching saves.
+    static constexpr std::size_t DeadlineStride = 8;
+
+public:
+    // The first construction calibrates the TSC (~10 ms) to convert the deadline.
+    explicit BatchingProducer(Ring& ring, std::size_t max_batch = 64,
+                              std::chrono::nanoseconds deadline = std::chrono::microseconds(2))
+        : ring(ring),
+          max_batch(max_batch ? max_batch : 1),
+          deadline_ticks(static_cast<std::uint64_t>(static_cast<double>(deadline.count()) * tsc_ticks_per_ns())) {}
+
+    BatchingProducer(const BatchingProducer&) = delete;
+    BatchingProducer& operator=(const BatchingProducer&) = delete;
+
+    ~BatchingProducer() {
+        flush();
+    }
+
+    template <class U>
+    bool push(U&& v) {
+        return emplace(std::forward<U>(v));
+    }
+
+    // Writes the element; publishes the batch when it is full or overdue.
+    // On a full ring the staged elements are published so the consumer can
+    // make room, and false is returned.
+    template <class... Args>
+    bool emplace(Args&&... args) {
+        if (!ring.stage(std::forward<Args>(args)...)) {
+            flush();
+            return false;
+        }
+        if (pending++ == 0) {
+            first_stamp = read_tsc();
+            if (batch == 1) {
+                flush();
+            }
+        } else if (pending >= batch || ((pending & (DeadlineStride - 1)) == 0 && read_tsc() - first_stamp >= deadline_ticks)) {
+            flush();
+        }
+        return true;
+    }
+
+    // Publishes every staged element and adapts the batch size.
+    void flush() noexcept {
+        if (pending == 0) {
+            return;
+        }
+        ring.publish();
+        if (ring.cached_depth() + batch > Ring::capacity()) {
+            if (ring.producer_depth() > pending) {
+                batch = batch * 2 < max_batch ? batch * 2 : max_batch;
+            } else {
+                batch = batch > 1 ? batch / 2 : 1;
+            }
+        }
+        pending = 0;
+    }
+
+    // For an idle producer: publishes the batch if its deadline has passed.
+    // Returns true if it published.
+    bool poll() noexcept {
+        if (pending == 0 || read_tsc() - first_stamp < deadline_ticks) {
+            return false;
+        }
+        flush();
+        return true;
+    }
+
+    // Elements written but not yet visible to the consumer.
+    [[nodiscard]] std::size_t staged() const noexcept {
+        return pending;
+    }
+
+    // Current adaptive batch size.
+    [[nodiscard]] std::size_t batch_size() const noexcept {
+        return batch;
+    }
+
+private:
+    Ring& ring;
+    std::size_t max_batch;
+    std::uint64_t deadline_ticks;
+    std::size_t batch = 1;
+    std::size_t pending = 0;
+    std::uint64_t first_stamp = 0;
+};
+
+}
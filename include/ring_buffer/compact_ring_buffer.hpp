@@ -0,0 +1,140 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include "ring_buffer/ring_buffer.hpp"
+
+// Small-footprint SPSC ring for processes holding many mostly-idle queues.
+// Requirements:
+//  - Capacity must be a power of two and below 2^bits(Index), so the wrapping
+//    Index counters still map onto slots with a mask.
+//  - Single producer thread calls push()/emplace(); single consumer thread calls pop()/try_pop().
+// Head, tail and the slots share one block. IndexPadding is the distance in
+// bytes between head and tail (and between tail and the slots): 64 puts them
+// on separate cache lines, 0 packs them together, which suits queues whose
+// producer and consumer are SMT siblings or that are rarely hot.
+
+namespace rb {
+
+namespace detail {
+template <std::size_t N>
+struct PadBytes {
+    unsigned char bytes[N];
+};
+template <>
+struct PadBytes<0> {};
+}
+
+template <typename T, std::size_t CapacityPow2, typename Index = std::uint32_t, std::size_t IndexPadding = 0>
+class CompactSpscRingBuffer {
+    static_assert(is_power_of_two(CapacityPow2), "CapacityPow2 must be a power of two");
+    static_assert(std::is_unsigned_v<Index>, "Index must be an unsigned integer type");
+    static_assert(CapacityPow2 <= std::numeric_limits<Index>::max() / 2 + 1, "CapacityPow2 does not fit Index");
+    static_assert(std::atomic<Index>::is_always_lock_free, "Index must be lock-free");
+
+    static constexpr std::size_t Capacity = CapacityPow2;
+    static constexpr Index Mask = static_cast<Index>(CapacityPow2 - 1);
+    static constexpr std::size_t Gap = IndexPadding > sizeof(Index) ? IndexPadding - sizeof(Index) : 0;
+
+public:
+    CompactSpscRingBuffer() = default;
+
+    CompactSpscRingBuffer(const CompactSpscRingBuffer&) = delete;
+    CompactSpscRingBuffer& operator=(const CompactSpscRingBuffer&) = delete;
+
+    ~CompactSpscRingBuffer() {
+        while (try_pop()) {
+        }
+    }
+
+    bool push(const T& v) noexcept(std::is_nothrow_copy_constructible_v<T>) {
+        return emplace(v);
+    }
+    bool push(T&& v) noexcept(std::is_nothrow_move_constructible_v<T>) {
+        return emplace(std::move(v));
+    }
+
+    template <class... Args>
+    bool emplace(Args&&... args) noexcept(std::is_nothrow_constructible_v<T, Args...>) {
+        const Index head_loaded = head.load(std::memory_order_relaxed);
+        if (static_cast<Index>(head_loaded - tail.load(std::memory_order_acquire)) >= Capacity) {
+            return false;
+        }
+        std::construct_at(slot(head_loaded), std::forward<Args>(args)...);
+        head.store(static_cast<Index>(head_loaded + 1), std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& out) noexcept(std::is_nothrow_move_assignable_v<T> && std::is_nothrow_move_constructible_v<T>) {
+        const Index tail_loaded = tail.load(std::memory_order_relaxed);
+        if (tail_loaded == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        T* s = slot(tail_loaded);
+        out = std::move(*s);
+        std::destroy_at(s);
+        tail.store(static_cast<Index>(tail_loaded + 1), std::memory_order_release);
+        return true;
+    }
+
+    std::optional<T> try_pop() noexcept(std::is_nothrow_move_constructible_v<T>) {
+        const Index tail_loaded = tail.load(std::memory_order_relaxed);
+        if (tail_loaded == head.load(std::memory_order_acquire)) {
+            return std::nullopt;
+        }
+        T* s = slot(tail_loaded);
+        std::optional<T> ret{std::move(*s)};
+        std::destroy_at(s);
+        tail.store(static_cast<Index>(tail_loaded + 1), std::memory_order_release);
+        return ret;
+    }
+
+    std::size_t pop_bulk(T* out, std::size_t max_n) noexcept(std::is_nothrow_move_assignable_v<T> && std::is_nothrow_move_constructible_v<T>) {
+        const Index tail_loaded = tail.load(std::memory_order_relaxed);
+        const std::size_t available = static_cast<Index>(head.load(std::memory_order_acquire) - tail_loaded);
+        const std::size_t to_pop = available < max_n ? available : max_n;
+        for (std::size_t i = 0; i < to_pop; ++i) {
+            T* s = slot(static_cast<Index>(tail_loaded + i));
+            out[i] = std::move(*s);
+            std::destroy_at(s);
+        }
+        if (to_pop != 0) {
+            tail.store(static_cast<Index>(tail_loaded + to_pop), std::memory_order_release);
+        }
+        return to_pop;
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] bool full() const noexcept {
+        return size() >= Capacity;
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept {
+        return static_cast<Index>(head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire));
+    }
+
+    static constexpr std::size_t capacity() noexcept {
+        return Capacity;
+    }
+
+private:
+    T* slot(Index counter) noexcept {
+        return reinterpret_cast<T*>(&storage[static_cast<std::size_t>(counter & Mask) * sizeof(T)]);
+    }
+
+    std::atomic<Index> head{0};
+    [[no_unique_address]] detail::PadBytes<Gap> head_pad;
+    std::atomic<Index> tail{0};
+    [[no_unique_address]] detail::PadBytes<Gap> tail_pad;
+    alignas(alignof(T)) unsigned char storage[Capacity * sizeof(T)];
+};
+
+}
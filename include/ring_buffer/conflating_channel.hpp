@@ -0,0 +1,139 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include "ring_buffer/ring_buffer.hpp"
+
+// Latest-value-wins SPSC channel keyed by a small integer.
+// Requirements:
+//  - Keys are in [0, MaxKeys); hash wider identifiers down before publishing.
+//  - T must be trivially copyable.
+//  - Single producer thread calls publish(); single consumer thread calls pop()/consume().
+// Each key owns a slot holding its latest value under a seqlock. A ring of dirty
+// keys carries every key at most once until the consumer takes it, so a slow
+// consumer sees one (latest) value per key instead of every intermediate update,
+// and its work scales with distinct keys rather than the message rate.
+
+namespace rb {
+
+template <typename T, std::size_t MaxKeys>
+class ConflatingChannel {
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+    static_assert(MaxKeys >= 1 && MaxKeys <= 0xFFFFFFFFu, "MaxKeys out of range");
+
+    static constexpr std::size_t Words = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+    struct alignas(64) Slot {
+        std::atomic<std::uint32_t> seq{0}; // odd while the producer is writing
+        std::atomic<bool> queued{false};   // key is in the dirty ring
+        std::array<std::atomic<std::uint64_t>, Words> words{};
+    };
+
+public:
+    using key_t = std::uint32_t;
+
+    ConflatingChannel() : slots(std::make_unique<Slot[]>(MaxKeys)) {}
+
+    ConflatingChannel(const ConflatingChannel&) = delete;
+    ConflatingChannel& operator=(const ConflatingChannel&) = delete;
+
+    // Overwrites the key's value and marks it dirty. Returns false only for a key
+    // outside [0, MaxKeys); publishing never blocks on a slow consumer.
+    bool publish(key_t key, const T& v) noexcept {
+        if (key >= MaxKeys) {
+            return false;
+        }
+        Slot& s = slots[key];
+        std::uint64_t buf[Words] {};
+        std::memcpy(buf, &v, sizeof(T));
+        const auto seq = s.seq.load(std::memory_order_relaxed);
+        s.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < Words; ++i) {
+            s.words[i].store(buf[i], std::memory_order_relaxed);
+        }
+        s.seq.store(seq + 2, std::memory_order_release);
+        // The RMW orders the value write against the consumer clearing the flag:
+        // either the consumer's read sees this value or the key is queued again.
+        if (!s.queued.exchange(true, std::memory_order_acq_rel)) {
+            dirty.push(key);
+        }
+        return true;
+    }
+
+    // Takes the next dirty key and its latest value.
+    bool pop(key_t& key, T& out) noexcept {
+        if (!dirty.pop(key)) {
+            return false;
+        }
+        Slot& s = slots[key];
+        s.queued.exchange(false, std::memory_order_acq_rel);
+        read(s, out);
+        return true;
+    }
+
+    // Calls f(key, value) for up to max_n dirty keys; returns how many were visited.
+    template <class F>
+    std::size_t consume(F&& f, std::size_t max_n = static_cast<std::size_t>(-1)) {
+        std::size_t n = 0;
+        key_t key;
+        T value;
+        while (n < max_n && pop(key, value)) {
+            f(key, value);
+            ++n;
+        }
+        return n;
+    }
+
+    // Latest value for key regardless of its dirty state; consumer or monitor thread.
+    bool load(key_t key, T& out) const noexcept {
+        if (key >= MaxKeys) {
+            return false;
+        }
+        read(slots[key], out);
+        return true;
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return dirty.empty();
+    }
+
+    // Number of keys currently waiting for the consumer.
+    [[nodiscard]] std::size_t pending() const noexcept {
+        return dirty.size();
+    }
+
+    static constexpr std::size_t max_keys() noexcept {
+        return MaxKeys;
+    }
+
+private:
+    static void read(const Slot& s, T& out) noexcept {
+        std::uint64_t buf[Words];
+        while (true) {
+            const auto before = s.seq.load(std::memory_order_acquire);
+            if (before & 1) {
+                cpu_relax();
+                continue;
+            }
+            for (std::size_t i = 0; i < Words; ++i) {
+                buf[i] = s.words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq.load(std::memory_order_relaxed) == before) {
+                break;
+            }
+        }
+        std::memcpy(&out, buf, sizeof(T));
+    }
+
+    std::unique_ptr<Slot[]> slots;
+    // Each key sits in the ring at most once, so this never fills up.
+    SpscRingBuffer<key_t, MaxKeys> dirty;
+};
+
+}
@@ -0,0 +1,267 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include "ring_buffer/ring_buffer.hpp"
+#include "ring_buffer/tsc.hpp"
+
+// A/B arbitration of two redundant feeds into one gap-checked sequence.
+// Requirements:
+//  - SeqFn maps a const T& to its std::uint64_t sequence number; both lines
+//    carry the same sequence space.
+//  - The arbiter is the only consumer of both rings, which provide pop() and
+//    peek(), e.g. SpscRingBuffer; T is default constructible.
+// The sequence starts at start_at() if set, otherwise at the lower of the two
+// lines' first messages (waiting up to hold_back for the second line to speak);
+// a message below that start arriving later is reported as a gap. Whichever
+// line delivers a sequence number first wins and later copies are dropped, so
+// every number comes out once and in order. A message ahead of the
+// next expected number is parked in a window indexed by seq & (Window - 1) and
+// flagged in a bitmap, keeping arbitration O(1) per message. A gap is held
+// back for hold_back waiting for the other line to fill it, then reported
+// through the gap callback and skipped; a message Window or more ahead gives
+// up everything still missing before it immediately.
+
+namespace rb {
+
+// Sequence numbers [first, first + count) were lost on both lines.
+using gap_callback_t = void (*)(void* ctx, std::uint64_t first, std::uint64_t count) noexcept;
+
+template <class Ring, class SeqFn, std::size_t Window = std::bit_ceil(Ring::capacity())>
+class FeedArbiter {
+    static_assert(is_power_of_two(Window), "Window must be a power of two");
+
+    using T = typename Ring::value_type;
+    static constexpr std::uint64_t Mask = Window - 1;
+
+public:
+    // The first construction calibrates the TSC (~10 ms) to convert hold_back.
+    FeedArbiter(Ring& a, Ring& b, std::chrono::nanoseconds hold_back, SeqFn seq_fn = {})
+        : lines{&a, &b},
+          hold_back_ticks(static_cast<std::uint64_t>(static_cast<double>(hold_back.count()) * tsc_ticks_per_ns())),
+          seq_fn(std::move(seq_fn)) {}
+
+    FeedArbiter(const FeedArbiter&) = delete;
+    FeedArbiter& operator=(const FeedArbiter&) = delete;
+
+    void set_gap_callback(gap_callback_t cb, void* ctx) noexcept {
+        on_gap = cb;
+        gap_ctx = ctx;
+    }
+
+    // Expects seq as the first number instead of taking it from the lines;
+    // call before the first pop(). Lower numbers are dropped as duplicates.
+    void start_at(std::uint64_t seq) noexcept {
+        next = first_seq = seq;
+        started = configured = true;
+    }
+
+    // Next message in sequence order. Returns false when nothing can be
+    // delivered yet: both lines are empty, or a gap is still being held back.
+    bool pop(T& out) {
+        while (true) {
+            if (has(next)) {
+                out = std::move(window[next & Mask]);
+                clear(next++);
+                if (--parked == 0) {
+                    gap_since = 0;
+                } else if (!has(next)) {
+                    gap_since = read_tsc(); // a new hole gets its own hold-back
+                }
+                return true;
+            }
+            if (overflow_pending) {
+                skip_missing(overflow_seq);
+                if (next == overflow_seq) {
+                    out = std::move(overflow);
+                    ++next;
+                    overflow_pending = false;
+                    return true;
+                }
+                continue;
+            }
+            const int got = pull(out);
+            if (got > 0) {
+                return true;
+            }
+            if (got < 0) {
+                continue;
+            }
+            if (parked == 0 || read_tsc() - gap_since < hold_back_ticks) {
+                return false;
+            }
+            skip_missing(next + Window);
+            gap_since = read_tsc();
+        }
+    }
+
+    // Calls f(msg) for up to max_n messages in sequence order; returns how many were visited.
+    template <class F>
+    std::size_t consume(F&& f, std::size_t max_n = static_cast<std::size_t>(-1)) {
+        std::size_t n = 0;
+        T msg;
+        while (n < max_n && pop(msg)) {
+            f(msg);
+            ++n;
+        }
+        return n;
+    }
+
+    // Next sequence number to be delivered (meaningless before the first message
+    // unless start_at() was called).
+    [[nodiscard]] std::uint64_t next_sequence() const noexcept {
+        return next;
+    }
+    // Sequence numbers given up as lost on both lines.
+    [[nodiscard]] std::uint64_t lost() const noexcept {
+        return lost_count;
+    }
+    [[nodiscard]] std::uint64_t duplicates() const noexcept {
+        return duplicate_count;
+    }
+    // Messages line (0 = A, 1 = B) delivered before the other line.
+    [[nodiscard]] std::uint64_t won_by(std::size_t line) const noexcept {
+        return wins[line];
+    }
+
+private:
+    // Takes one message from each line in turn. Returns 1 if out holds the next
+    // message, -1 if something was parked or dropped, 0 if both lines were empty.
+    int pull(T& out) {
+        if (!started && !seed()) {
+            return 0;
+        }
+        int result = 0;
+        for (std::size_t k = 0; k < 2; ++k) {
+            const std::size_t line = turn;
+            turn ^= 1;
+            T msg;
+            if (!lines[line]->pop(msg)) {
+                continue;
+            }
+            const std::uint64_t s = seq_fn(static_cast<const T&>(msg));
+            if (s < first_seq && !configured) {
+                // Before the start taken from the other line: never delivered, so lost.
+                ++lost_count;
+                if (on_gap) {
+                    on_gap(gap_ctx, s, 1);
+                }
+                result = -1;
+                continue;
+            }
+            if (s < next || (s - next < Window && has(s))) {
+                ++duplicate_count;
+                result = -1;
+                continue;
+            }
+            ++wins[line];
+            if (s == next) {
+                out = std::move(msg);
+                ++next;
+                if (parked != 0) {
+                    gap_since = read_tsc(); // the next hole gets its own hold-back
+                }
+                return 1;
+            }
+            if (s - next >= Window) {
+                overflow = std::move(msg);
+                overflow_seq = s;
+                overflow_pending = true;
+                return -1;
+            }
+            park(s, std::move(msg));
+            result = -1;
+        }
+        return result;
+    }
+
+    // Starts the sequence at the lower of the lines' first messages. With only
+    // one line readable, waits up to hold_back for the other before starting.
+    bool seed() {
+        T msg;
+        std::uint64_t lowest = 0;
+        std::size_t readable = 0;
+        for (Ring* line : lines) {
+            if (line->peek(msg)) {
+                const std::uint64_t s = seq_fn(static_cast<const T&>(msg));
+                lowest = readable++ == 0 || s < lowest ? s : lowest;
+            }
+        }
+        if (readable == 0) {
+            return false;
+        }
+        if (readable == 1) {
+            const std::uint64_t now = read_tsc();
+            if (!seed_waiting) {
+                seed_waiting = true;
+                seed_since = now;
+            }
+            if (now - seed_since < hold_back_ticks) {
+                return false;
+            }
+        }
+        next = first_seq = lowest;
+        started = true;
+        return true;
+    }
+
+    void park(std::uint64_t s, T&& msg) {
+        const auto i = s & Mask;
+        window[i] = std::move(msg);
+        bits[i >> 6] |= std::uint64_t{1} << (i & 63);
+        if (parked++ == 0) {
+            gap_since = read_tsc();
+        }
+    }
+
+    // Gives up the missing numbers from next up to the first parked one or limit.
+    void skip_missing(std::uint64_t limit) {
+        const std::uint64_t first = next;
+        while (next < limit && !has(next)) {
+            ++next;
+        }
+        if (next != first) {
+            lost_count += next - first;
+            if (on_gap) {
+                on_gap(gap_ctx, first, next - first);
+            }
+        }
+    }
+
+    [[nodiscard]] bool has(std::uint64_t s) const noexcept {
+        const auto i = s & Mask;
+        return (bits[i >> 6] >> (i & 63)) & 1;
+    }
+    void clear(std::uint64_t s) noexcept {
+        const auto i = s & Mask;
+        bits[i >> 6] &= ~(std::uint64_t{1} << (i & 63));
+    }
+
+    std::array<Ring*, 2> lines;
+    std::uint64_t hold_back_ticks;
+    [[no_unique_address]] SeqFn seq_fn;
+    std::array<T, Window> window{};
+    std::array<std::uint64_t, (Window + 63) / 64> bits{};
+    std::size_t parked = 0;
+    std::uint64_t next = 0;
+    std::uint64_t gap_since = 0;
+    bool started = false;
+    bool configured = false;  // start_at() was called
+    bool seed_waiting = false; // one line has spoken; waiting for the other
+    std::uint64_t seed_since = 0;
+    std::uint64_t first_seq = 0;
+    std::size_t turn = 0;
+    T overflow{};
+    std::uint64_t overflow_seq = 0;
+    bool overflow_pending = false;
+    std::uint64_t lost_count = 0;
+    std::uint64_t duplicate_count = 0;
+    std::array<std::uint64_t, 2> wins{};
+    gap_callback_t on_gap = nullptr;
+    void* gap_ctx = nullptr;
+};
+
+}
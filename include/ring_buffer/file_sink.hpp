@@ -0,0 +1,452 @@
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define RB_HAS_IO_URING 1
+#endif
+#include "ring_buffer/ring_buffer.hpp"
+
+// Ring-to-file sink: journals a ring's records straight from its slots.
+// Requirements:
+//  - Ring provides read_spans()/release() over a trivially copyable value_type,
+//    e.g. SpscRingBuffer; the sink is the ring's only consumer.
+//  - With Options::direct_block set, fd is opened with O_DIRECT, the ring's
+//    storage is block aligned (numa::make_ring allocates whole pages) and
+//    Capacity * sizeof(T) is a multiple of the block. A flush() that has to
+//    write a partial last block leaves the file offset unaligned, so it must be
+//    the sink's last write: poll() and flush() return false afterwards.
+// poll() submits the newly readable contiguous runs as writes of up to
+// max_write_bytes each and releases slots only once their write has completed,
+// in ring order, so nothing is copied into an intermediate buffer. Writes go
+// through io_uring (raw syscalls, no liburing) with up to queue_depth in
+// flight; where io_uring is unavailable or disabled, poll() falls back to a
+// synchronous pwritev() of both runs.
+
+namespace rb {
+
+namespace detail {
+
+#if defined(RB_HAS_IO_URING)
+// Minimal io_uring: one submission and one completion ring, mapped once.
+class IoUring {
+public:
+    IoUring() = default;
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    ~IoUring() {
+        if (sq_ptr != MAP_FAILED && sq_ptr != nullptr) {
+            munmap(sq_ptr, sq_bytes);
+        }
+        if (cq_ptr != sq_ptr && cq_ptr != MAP_FAILED && cq_ptr != nullptr) {
+            munmap(cq_ptr, cq_bytes);
+        }
+        if (sqes != MAP_FAILED && sqes != nullptr) {
+            munmap(sqes, sqe_bytes);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    bool init(unsigned entries) noexcept {
+        io_uring_params p{};
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+        if (fd < 0) {
+            return false;
+        }
+        sq_bytes = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_bytes = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        const bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) {
+            sq_bytes = cq_bytes = sq_bytes > cq_bytes ? sq_bytes : cq_bytes;
+        }
+        sq_ptr = mmap(nullptr, sq_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sq_ptr == MAP_FAILED) {
+            return false;
+        }
+        cq_ptr = single ? sq_ptr
+                        : mmap(nullptr, cq_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED) {
+            return false;
+        }
+        sqe_bytes = p.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(
+            mmap(nullptr, sqe_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+        auto* sq = static_cast<unsigned char*>(sq_ptr);
+        auto* cq = static_cast<unsigned char*>(cq_ptr);
+        sq_head = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        sq_entries = p.sq_entries;
+        return true;
+    }
+
+    // Queues a write; visible to the kernel after the next enter().
+    bool queue_write(int file, const void* buf, std::size_t len, std::uint64_t off, std::uint64_t user_data) noexcept {
+        const unsigned tail = *sq_tail;
+        if (tail - std::atomic_ref<unsigned>(*sq_head).load(std::memory_order_acquire) >= sq_entries) {
+            return false;
+        }
+        const unsigned idx = tail & sq_mask;
+        io_uring_sqe& sqe = sqes[idx];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_WRITE;
+        sqe.fd = file;
+        sqe.addr = reinterpret_cast<std::uint64_t>(buf);
+        sqe.len = static_cast<std::uint32_t>(len);
+        sqe.off = off;
+        sqe.user_data = user_data;
+        sq_array[idx] = idx;
+        std::atomic_ref<unsigned>(*sq_tail).store(tail + 1, std::memory_order_release);
+        ++unsubmitted;
+        ++outstanding;
+        return true;
+    }
+
+    // Submits queued writes and, if wait_for > 0, blocks until that many completions exist.
+    int enter(unsigned wait_for) noexcept {
+        const auto flags = wait_for ? IORING_ENTER_GETEVENTS : 0u;
+        const long r = syscall(__NR_io_uring_enter, fd, unsubmitted, wait_for, flags, nullptr, 0);
+        if (r < 0) {
+            return -errno;
+        }
+        unsubmitted -= static_cast<unsigned>(r) < unsubmitted ? static_cast<unsigned>(r) : unsubmitted;
+        return 0;
+    }
+
+    // Calls f(user_data, res) for every available completion.
+    template <class F>
+    unsigned reap(F&& f) {
+        unsigned head = *cq_head;
+        const unsigned tail = std::atomic_ref<unsigned>(*cq_tail).load(std::memory_order_acquire);
+        const unsigned n = tail - head;
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes[head & cq_mask];
+            f(cqe.user_data, cqe.res);
+        }
+        std::atomic_ref<unsigned>(*cq_head).store(head, std::memory_order_release);
+        outstanding -= n;
+        return n;
+    }
+
+    // Writes queued whose completion has not been reaped yet.
+    [[nodiscard]] unsigned pending() const noexcept {
+        return outstanding;
+    }
+
+private:
+    int fd = -1;
+    void* sq_ptr = nullptr;
+    void* cq_ptr = nullptr;
+    std::size_t sq_bytes = 0;
+    std::size_t cq_bytes = 0;
+    std::size_t sqe_bytes = 0;
+    io_uring_sqe* sqes = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned sq_mask = 0;
+    unsigned cq_mask = 0;
+    unsigned sq_entries = 0;
+    unsigned unsubmitted = 0;
+    unsigned outstanding = 0;
+};
+#endif
+
+}
+
+template <class Ring>
+class FileSink {
+    using T = typename Ring::value_type;
+    static_assert(std::is_trivially_copyable_v<T>, "FileSink needs a trivially copyable record type");
+
+public:
+    struct Options {
+        unsigned queue_depth = 8;              // writes in flight
+        std::size_t max_write_bytes = 1 << 20; // per write; rounded down to whole records
+        bool use_io_uring = true;
+        std::size_t direct_block = 0;          // O_DIRECT block size, 0 when fd is buffered
+        std::uint64_t file_offset = 0;         // where the first record goes
+    };
+
+    FileSink(Ring& ring, int fd) : FileSink(ring, fd, Options{}) {}
+
+    FileSink(Ring& ring, int fd, Options opts)
+        : ring(ring), fd(fd), opts(opts), offset(opts.file_offset),
+          writes(opts.queue_depth ? opts.queue_depth : 1) {
+        unit = 1;
+        if (opts.direct_block != 0) {
+            unit = opts.direct_block / std::gcd(opts.direct_block, sizeof(T));
+        }
+        max_records = opts.max_write_bytes / sizeof(T) / unit * unit;
+        max_records = max_records ? max_records : unit;
+#if defined(RB_HAS_IO_URING)
+        uring_ok = opts.use_io_uring && uring.init(static_cast<unsigned>(writes.size()));
+#endif
+    }
+
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+
+    // Waits for writes still in flight, even after a failure, since the kernel
+    // reads them from the ring's slots; records never submitted stay in the ring.
+    ~FileSink() {
+#if defined(RB_HAS_IO_URING)
+        while (uring_ok && uring.pending() != 0) {
+            if (const int r = uring.enter(1); r < 0 && r != -EINTR && r != -EAGAIN && r != -EBUSY) {
+                break; // the ring itself is unusable; nothing left to wait on
+            }
+            reap();
+        }
+#endif
+    }
+
+    // Consumer: reaps finished writes, releases their slots and submits the
+    // newly readable records. Returns false once a write has failed (error()).
+    bool poll() {
+        if (err != 0 || sealed) {
+            return false;
+        }
+#if defined(RB_HAS_IO_URING)
+        if (uring_ok) {
+            reap();
+            submit();
+            return err == 0;
+        }
+#endif
+        write_sync(false);
+        return err == 0;
+    }
+
+    // Writes every readable record and waits until all of it is on file. An
+    // O_DIRECT tail that is not a whole block is written with O_DIRECT dropped
+    // for that one write, which seals the sink (see above).
+    bool flush() {
+        if (sealed) {
+            return false;
+        }
+        while (err == 0) {
+            poll();
+#if defined(RB_HAS_IO_URING)
+            if (uring_ok && in_flight != 0) {
+                wait_one();
+                continue;
+            }
+#endif
+            const std::size_t left = ring.read_spans().size();
+            if (left == 0) {
+                break;
+            }
+            if (left < unit && opts.direct_block != 0) {
+                const int fl = fcntl(fd, F_GETFL);
+                if (fl < 0 || fcntl(fd, F_SETFL, fl & ~O_DIRECT) != 0) {
+                    err = errno; // never send the tail as an unaligned O_DIRECT write
+                    break;
+                }
+                sealed = true;
+                write_sync(true);
+                if (fcntl(fd, F_SETFL, fl) != 0 && err == 0) {
+                    err = errno;
+                }
+                break;
+            }
+        }
+        return err == 0;
+    }
+
+    [[nodiscard]] bool using_io_uring() const noexcept {
+        return uring_ok;
+    }
+    [[nodiscard]] std::uint64_t bytes_written() const noexcept {
+        return written;
+    }
+    // errno of the first failed write, 0 if none.
+    [[nodiscard]] int error() const noexcept {
+        return err;
+    }
+
+private:
+    struct Write {
+        const unsigned char* data = nullptr;
+        std::size_t records = 0;
+        std::size_t bytes = 0;
+        std::size_t done = 0;
+        std::uint64_t offset = 0;
+        bool finished = false;
+    };
+
+    // Up to max records from the readable records after skip, limited to one contiguous run.
+    std::pair<const T*, std::size_t> next_run(std::size_t skip, std::size_t max) {
+        const auto spans = ring.read_spans(skip + max);
+        if (skip < spans.first.size()) {
+            return {spans.first.data() + skip, spans.first.size() - skip};
+        }
+        skip -= spans.first.size();
+        return {spans.second.data() + skip, skip < spans.second.size() ? spans.second.size() - skip : 0};
+    }
+
+#if defined(RB_HAS_IO_URING)
+    void submit() {
+        bool queued = false;
+        while (in_flight < writes.size()) {
+            auto [data, n] = next_run(submitted, max_records);
+            n = n / unit * unit;
+            if (n == 0) {
+                break;
+            }
+            Write& w = writes[(first + in_flight) % writes.size()];
+            w = Write{reinterpret_cast<const unsigned char*>(data), n, n * sizeof(T), 0, offset, false};
+            if (!uring.queue_write(fd, w.data, w.bytes, w.offset, (first + in_flight) % writes.size())) {
+                break;
+            }
+            offset += w.bytes;
+            submitted += n;
+            ++in_flight;
+            queued = true;
+        }
+        if (queued) {
+            if (const int r = uring.enter(0); r < 0) {
+                err = -r;
+            }
+        }
+    }
+
+    void reap() {
+        bool requeued = false;
+        uring.reap([&](std::uint64_t slot, int res) {
+            Write& w = writes[slot];
+            if (res < 0 && res != -EINTR && res != -EAGAIN) {
+                err = -res;
+                return;
+            }
+            if (res == 0) {
+                err = EIO;
+                return;
+            }
+            w.done += res > 0 ? static_cast<std::size_t>(res) : 0;
+            if (w.done < w.bytes) {
+                // Short write: send the rest from the same slots (always fits: a write holds at most one SQE).
+                requeued |= uring.queue_write(fd, w.data + w.done, w.bytes - w.done, w.offset + w.done, slot);
+                return;
+            }
+            w.finished = true;
+        });
+        if (requeued) {
+            if (const int r = uring.enter(0); r < 0) {
+                err = -r;
+            }
+        }
+        std::size_t released = 0;
+        while (in_flight != 0 && writes[first].finished) {
+            released += writes[first].records;
+            written += writes[first].bytes;
+            first = (first + 1) % writes.size();
+            --in_flight;
+        }
+        if (released != 0) {
+            ring.release(released);
+            submitted -= released;
+        }
+    }
+
+    void wait_one() {
+        if (const int r = uring.enter(1); r < 0 && r != -EINTR) {
+            err = -r;
+            return;
+        }
+        reap();
+    }
+#endif
+
+    // pwritev() of both readable runs; tail_ok allows a partial O_DIRECT block.
+    void write_sync(bool tail_ok) {
+        const auto spans = ring.read_spans(max_records);
+        std::size_t n = spans.size();
+        if (!tail_ok) {
+            n = n / unit * unit;
+        }
+        if (n == 0) {
+            return;
+        }
+        const std::size_t first_n = n < spans.first.size() ? n : spans.first.size();
+        iovec iov[2] = {
+            {const_cast<T*>(spans.first.data()), first_n * sizeof(T)},
+            {const_cast<T*>(spans.second.data()), (n - first_n) * sizeof(T)},
+        };
+        const std::size_t total = n * sizeof(T);
+        std::size_t done = 0;
+        while (done < total) {
+            const int skip = iov[0].iov_len == 0 ? 1 : 0;
+            const int cnt = iov[1].iov_len == 0 ? 1 - skip : 2 - skip;
+            const auto w = pwritev(fd, iov + skip, cnt, static_cast<off_t>(offset + done));
+            if (w < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                err = errno;
+                break;
+            }
+            if (w == 0) {
+                err = EIO;
+                break;
+            }
+            std::size_t adv = static_cast<std::size_t>(w);
+            done += adv;
+            for (auto& part : iov) {
+                const std::size_t take = adv < part.iov_len ? adv : part.iov_len;
+                part.iov_base = static_cast<unsigned char*>(part.iov_base) + take;
+                part.iov_len -= take;
+                adv -= take;
+            }
+        }
+        // Only whole records are released; a failed write leaves the rest queued.
+        const std::size_t records = done / sizeof(T);
+        ring.release(records);
+        offset += records * sizeof(T);
+        written += records * sizeof(T);
+    }
+
+    Ring& ring;
+    const int fd;
+    const Options opts;
+    std::uint64_t offset;
+    std::size_t unit = 1;          // records per submitted write must be a multiple of this
+    std::size_t max_records = 1;
+    std::vector<Write> writes;     // FIFO of in-flight writes, in ring order
+    std::size_t first = 0;
+    std::size_t in_flight = 0;
+    std::size_t submitted = 0;     // records handed to the kernel but not released
+    std::uint64_t written = 0;
+    int err = 0;
+    bool sealed = false; // a partial O_DIRECT block was written; no more writes
+    bool uring_ok = false;
+#if defined(RB_HAS_IO_URING)
+    detail::IoUring uring;
+#endif
+};
+
+}
@@ -0,0 +1,211 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ring_buffer/ring_buffer.hpp"
+#include "ring_buffer/tsc.hpp"
+
+// Memory-mapped file source that replays a capture file into a ring.
+// Requirements:
+//  - The source is the ring's only producer; Ring provides emplace_bulk() and
+//    stage()/publish(), e.g. SpscRingBuffer.
+//  - FixedRecords: the file is an array of the ring's trivially copyable T.
+//  - LengthPrefixed<Decode>: each record is a native-endian std::uint32_t
+//    payload size followed by the payload; Decode(data, size) turns it into a
+//    T; its operator() must be const. The default decoder yields RecordView,
+//    which points into the mapping and stays valid for the source's lifetime.
+// The file is mapped read-only with MADV_SEQUENTIAL, and MADV_WILLNEED keeps
+// the kernel reading one 8 MiB window ahead of the cursor. pump() pushes up
+// to max_n records and publishes once: as fast as possible by default, or,
+// after pace(), only the records whose original timestamp (relative to the
+// first record, divided by speed) has come due.
+
+namespace rb {
+
+struct RecordView {
+    const unsigned char* data;
+    std::uint32_t size;
+};
+
+struct FixedRecords {};
+
+struct ViewDecode {
+    RecordView operator()(const unsigned char* data, std::uint32_t size) const noexcept {
+        return {data, size};
+    }
+};
+
+template <class Decode = ViewDecode>
+struct LengthPrefixed {
+    [[no_unique_address]] Decode decode{};
+};
+
+template <class Ring, class Framing = FixedRecords>
+class FileSource {
+    using T = typename Ring::value_type;
+    static constexpr bool Fixed = std::is_same_v<Framing, FixedRecords>;
+    static_assert(!Fixed || std::is_trivially_copyable_v<T>, "fixed-size records need a trivially copyable T");
+
+    static constexpr std::size_t ReadaheadBytes = 8u << 20;
+
+public:
+    // Nanosecond timestamp of a record, used for paced replay.
+    using timestamp_fn = std::uint64_t (*)(const T&) noexcept;
+
+    FileSource(Ring& ring, const char* path, Framing framing = {}) : ring(ring), framing(std::move(framing)) {
+        const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st {};
+        const bool stat_ok = ::fstat(fd, &st) == 0;
+        if (stat_ok && st.st_size > 0) {
+            bytes = static_cast<std::size_t>(st.st_size);
+            void* p = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                base = static_cast<const unsigned char*>(p);
+                ::madvise(p, bytes, MADV_SEQUENTIAL);
+                readahead();
+                readahead();
+            } else {
+                bytes = 0;
+            }
+        }
+        opened = stat_ok && (st.st_size == 0 || base != nullptr);
+        ::close(fd);
+    }
+
+    FileSource(const FileSource&) = delete;
+    FileSource& operator=(const FileSource&) = delete;
+
+    ~FileSource() {
+        if (base != nullptr) {
+            ::munmap(const_cast<unsigned char*>(base), bytes);
+        }
+    }
+
+    // Replays records at their original pace (speed > 1 is faster); pass
+    // nullptr to go back to as-fast-as-possible. The first record pumped
+    // after this call anchors the timeline.
+    void pace(timestamp_fn ts, double speed = 1.0) {
+        timestamp = ts;
+        scaled_ticks_per_ns = ts ? tsc_ticks_per_ns() / (speed > 0 ? speed : 1.0) : 0;
+        anchored = false;
+    }
+
+    // Pushes up to max_n records; returns how many. Fewer means the ring is
+    // full, the file is exhausted, or the next record is not due yet.
+    std::size_t pump(std::size_t max_n = static_cast<std::size_t>(-1)) {
+        if constexpr (Fixed) {
+            if (timestamp == nullptr) {
+                std::size_t n = (bytes - pos) / sizeof(T);
+                n = n < max_n ? n : max_n;
+                const auto* first = reinterpret_cast<const T*>(base + pos);
+                const std::size_t pushed = n ? ring.emplace_bulk(first, first + n) : 0;
+                advance(pushed * sizeof(T));
+                return pushed;
+            }
+        }
+        std::size_t pushed = 0;
+        const std::uint64_t now = timestamp ? read_tsc() : 0;
+        while (pushed < max_n) {
+            std::size_t len = 0;
+            const T* rec = peek(len);
+            if (rec == nullptr || (timestamp && !due(*rec, now)) || !ring.stage(*rec)) {
+                break;
+            }
+            advance(len);
+            ++pushed;
+        }
+        if (pushed != 0) {
+            ring.publish();
+        }
+        return pushed;
+    }
+
+    // False if the file could not be opened or mapped.
+    [[nodiscard]] bool ok() const noexcept {
+        return opened;
+    }
+    // True once no complete record is left.
+    [[nodiscard]] bool done() const {
+        std::size_t len = 0;
+        return peek(len) == nullptr;
+    }
+    [[nodiscard]] std::size_t size_bytes() const noexcept {
+        return bytes;
+    }
+    [[nodiscard]] std::size_t position() const noexcept {
+        return pos;
+    }
+
+private:
+    // Next complete record and its size in the file, or nullptr at the end.
+    const T* peek(std::size_t& len) const {
+        if constexpr (Fixed) {
+            len = sizeof(T);
+            return bytes - pos >= sizeof(T) ? reinterpret_cast<const T*>(base + pos) : nullptr;
+        } else {
+            std::uint32_t size = 0;
+            if (bytes - pos < sizeof(size)) {
+                return nullptr;
+            }
+            std::memcpy(&size, base + pos, sizeof(size));
+            if (bytes - pos - sizeof(size) < size) {
+                return nullptr;
+            }
+            len = sizeof(size) + size;
+            staged = framing.decode(base + pos + sizeof(size), size);
+            return &staged;
+        }
+    }
+
+    bool due(const T& rec, std::uint64_t now) {
+        const std::uint64_t ts = timestamp(rec);
+        if (!anchored) {
+            anchored = true;
+            first_ts = ts;
+            start_tsc = now;
+        }
+        const double offset_ns = ts > first_ts ? static_cast<double>(ts - first_ts) : 0.0;
+        return static_cast<double>(now - start_tsc) >= offset_ns * scaled_ticks_per_ns;
+    }
+
+    void advance(std::size_t n) noexcept {
+        pos += n;
+        if (pos + ReadaheadBytes >= advised) {
+            readahead();
+        }
+    }
+
+    void readahead() noexcept {
+        if (advised >= bytes) {
+            return;
+        }
+        const std::size_t len = bytes - advised < ReadaheadBytes ? bytes - advised : ReadaheadBytes;
+        ::madvise(const_cast<unsigned char*>(base) + advised, len, MADV_WILLNEED);
+        advised += len;
+    }
+
+    Ring& ring;
+    [[no_unique_address]] Framing framing;
+    const unsigned char* base = nullptr;
+    std::size_t bytes = 0;
+    std::size_t pos = 0;
+    std::size_t advised = 0; // readahead requested up to here
+    bool opened = false;
+    mutable std::conditional_t<Fixed, char, T> staged{};
+    timestamp_fn timestamp = nullptr;
+    double scaled_ticks_per_ns = 0;
+    bool anchored = false;
+    std::uint64_t first_ts = 0;
+    std::uint64_t start_tsc = 0;
+};
+
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// Type-erased void() callables living in raw storage, shared by TaskRing
+// (variable-size records in a byte ring) and ThreadPool (fixed-size slots).
+// callable_ops<Fn> is the single place that runs, relocates and destroys a
+// callable of type Fn through a void pointer.
+
+namespace rb::detail {
+
+enum class CallableOp {
+    run,      // invoke
+    consume,  // invoke, then destroy
+    relocate, // move-construct self from `from`, then destroy `from`
+    destroy,
+};
+
+using callable_ops_t = void (*)(CallableOp op, void* self, void* from) noexcept;
+
+// Callables must not throw. relocate is only available for nothrow movable Fn.
+template <class Fn>
+void callable_ops(CallableOp op, void* self, void* from) noexcept {
+    auto* fn = static_cast<Fn*>(self);
+    switch (op) {
+    case CallableOp::run:
+        (*fn)();
+        break;
+    case CallableOp::consume:
+        (*fn)();
+        std::destroy_at(fn);
+        break;
+    case CallableOp::relocate:
+        if constexpr (std::is_nothrow_move_constructible_v<Fn>) {
+            std::construct_at(fn, std::move(*static_cast<Fn*>(from)));
+            std::destroy_at(static_cast<Fn*>(from));
+        }
+        break;
+    case CallableOp::destroy:
+        std::destroy_at(fn);
+        break;
+    }
+}
+
+// Movable callable with the capture stored in place, for use as a ring slot.
+template <std::size_t Capture>
+class InlineTask {
+public:
+    InlineTask() noexcept = default;
+
+    template <class F, class Fn = std::decay_t<F>>
+        requires(!std::is_same_v<Fn, InlineTask>)
+    InlineTask(F&& f) noexcept(std::is_nothrow_constructible_v<Fn, F>) {
+        static_assert(std::is_invocable_v<Fn&>, "task must be invocable with no arguments");
+        static_assert(sizeof(Fn) <= Capture && alignof(Fn) <= alignof(std::max_align_t),
+                      "capture does not fit InlineCapture");
+        static_assert(std::is_nothrow_move_constructible_v<Fn>, "task must be nothrow movable");
+        std::construct_at(reinterpret_cast<Fn*>(bytes), std::forward<F>(f));
+        ops = &callable_ops<Fn>;
+    }
+
+    InlineTask(InlineTask&& o) noexcept : ops(std::exchange(o.ops, nullptr)) {
+        if (ops) {
+            ops(CallableOp::relocate, bytes, o.bytes);
+        }
+    }
+
+    InlineTask& operator=(InlineTask&& o) noexcept {
+        if (this != &o) {
+            reset();
+            ops = std::exchange(o.ops, nullptr);
+            if (ops) {
+                ops(CallableOp::relocate, bytes, o.bytes);
+            }
+        }
+        return *this;
+    }
+
+    ~InlineTask() {
+        reset();
+    }
+
+    void operator()() noexcept {
+        ops(CallableOp::run, bytes, nullptr);
+    }
+
+private:
+    void reset() noexcept {
+        if (ops) {
+            std::exchange(ops, nullptr)(CallableOp::destroy, bytes, nullptr);
+        }
+    }
+
+    callable_ops_t ops = nullptr;
+    alignas(std::max_align_t) unsigned char bytes[Capture];
+};
+
+}
@@ -0,0 +1,177 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include "ring_buffer/ring_buffer.hpp"
+#include "ring_buffer/tsc.hpp"
+
+// K-way ordered merge over the consumer ends of K rings.
+// Requirements:
+//  - Each input is individually ordered by KeyFn(const T&) (e.g. exchange
+//    timestamp or sequence number); keys compare with <.
+//  - The merge consumer is the only consumer of every input ring.
+//  - T must be default constructible (items are staged in per-input batches).
+// Items are pulled from each ring with pop_bulk() into a local batch, and a
+// binary min-heap over the inputs' batch heads picks the next item, so a ring
+// is touched once per Batch items rather than once per emitted item.
+// An input with nothing buffered blocks the merge (its next key is unknown)
+// until it has been empty for hold_back; after that it is treated as quiet and
+// skipped until data shows up again. Items arriving from a quiet input with a
+// key below what was already emitted are passed through as they come.
+
+namespace rb {
+
+template <class Ring, std::size_t K, class KeyFn, std::size_t Batch = 32>
+class MergeConsumer {
+    static_assert(K >= 1 && Batch >= 1, "MergeConsumer needs at least one input and a non-empty batch");
+
+    using T = typename Ring::value_type;
+    using key_t = std::decay_t<std::invoke_result_t<KeyFn&, const T&>>;
+
+    struct Input {
+        Ring* ring = nullptr;
+        std::size_t pos = 0;
+        std::size_t len = 0;
+        std::uint64_t empty_since = 0; // read_tsc() when first seen empty, 0 otherwise
+        std::array<T, Batch> buf{};
+    };
+
+    struct Entry {
+        key_t key;
+        std::size_t input;
+    };
+
+public:
+    // The first construction calibrates the TSC (~10 ms) to convert hold_back.
+    MergeConsumer(const std::array<Ring*, K>& rings, std::chrono::nanoseconds hold_back, KeyFn key_fn = {})
+        : hold_back_ticks(static_cast<std::uint64_t>(static_cast<double>(hold_back.count()) * tsc_ticks_per_ns())),
+          key_fn(std::move(key_fn)) {
+        for (std::size_t i = 0; i < K; ++i) {
+            inputs[i].ring = rings[i];
+        }
+    }
+
+    MergeConsumer(const MergeConsumer&) = delete;
+    MergeConsumer& operator=(const MergeConsumer&) = delete;
+
+    // Next item in key order without taking it, or nullptr if none can be
+    // emitted yet (no data, or an input still within its hold-back).
+    const T* peek() {
+        const auto i = ready();
+        return i == K ? nullptr : &inputs[i].buf[inputs[i].pos];
+    }
+
+    bool pop(T& out) {
+        const auto i = ready();
+        if (i == K) {
+            return false;
+        }
+        Input& in = inputs[i];
+        out = std::move(in.buf[in.pos++]);
+        if (in.pos < in.len) {
+            heap[0].key = key_fn(in.buf[in.pos]);
+        } else {
+            heap[0] = heap[--heap_size];
+        }
+        sift_down(0);
+        return true;
+    }
+
+    // Calls f(item) for up to max_n items in key order; returns how many were visited.
+    template <class F>
+    std::size_t consume(F&& f, std::size_t max_n = static_cast<std::size_t>(-1)) {
+        std::size_t n = 0;
+        T item;
+        while (n < max_n && pop(item)) {
+            f(item);
+            ++n;
+        }
+        return n;
+    }
+
+    // Items pulled off the rings but not emitted yet.
+    [[nodiscard]] std::size_t buffered() const noexcept {
+        std::size_t n = 0;
+        for (const auto& in : inputs) {
+            n += in.len - in.pos;
+        }
+        return n;
+    }
+
+private:
+    // Refills drained inputs and returns the input holding the next item, or K.
+    std::size_t ready() {
+        if (heap_size < K) {
+            std::uint64_t now = 0;
+            bool waiting = false;
+            for (std::size_t i = 0; i < K; ++i) {
+                Input& in = inputs[i];
+                if (in.pos < in.len) {
+                    continue;
+                }
+                in.pos = 0;
+                in.len = in.ring->pop_bulk(in.buf.data(), Batch);
+                if (in.len != 0) {
+                    in.empty_since = 0;
+                    heap[heap_size] = Entry{key_fn(in.buf[0]), i};
+                    sift_up(heap_size++);
+                    continue;
+                }
+                now = now ? now : read_tsc();
+                if (in.empty_since == 0) {
+                    in.empty_since = now;
+                }
+                waiting |= now - in.empty_since < hold_back_ticks;
+            }
+            if (heap_size == 0 || waiting) {
+                return K;
+            }
+        }
+        return heap[0].input;
+    }
+
+    bool before(const Entry& a, const Entry& b) const {
+        return a.key < b.key || (!(b.key < a.key) && a.input < b.input);
+    }
+
+    void sift_up(std::size_t i) {
+        while (i > 0) {
+            const std::size_t parent = (i - 1) / 2;
+            if (!before(heap[i], heap[parent])) {
+                break;
+            }
+            std::swap(heap[i], heap[parent]);
+            i = parent;
+        }
+    }
+
+    void sift_down(std::size_t i) {
+        while (true) {
+            const std::size_t l = 2 * i + 1;
+            const std::size_t r = l + 1;
+            std::size_t m = i;
+            if (l < heap_size && before(heap[l], heap[m])) {
+                m = l;
+            }
+            if (r < heap_size && before(heap[r], heap[m])) {
+                m = r;
+            }
+            if (m == i) {
+                return;
+            }
+            std::swap(heap[i], heap[m]);
+            i = m;
+        }
+    }
+
+    std::array<Input, K> inputs;
+    std::array<Entry, K> heap{};
+    std::size_t heap_size = 0;
+    std::uint64_t hold_back_ticks;
+    [[no_unique_address]] KeyFn key_fn;
+};
+
+}
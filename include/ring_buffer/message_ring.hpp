@@ -0,0 +1,154 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "ring_buffer/ring_buffer.hpp"
+
+// Lock-free SPSC ring of heterogeneous messages, each taking only its own size.
+// Requirements:
+//  - CapacityBytes must be a power of two (for fast masking).
+//  - Single producer thread calls push<M>(); single consumer thread calls consume().
+//  - Msgs are distinct types, at most 64-byte aligned and smaller than 64 KiB.
+//  - The visitor passed to consume() must not throw.
+// Each record is an 8-byte header (record size, type tag, payload offset)
+// followed by the message constructed in place at its natural alignment.
+// consume() dispatches through a jump table generated from Msgs, calls the
+// visitor with a Msg&, destroys the message and releases the bytes.
+
+namespace rb {
+
+template <std::size_t CapacityBytes, typename... Msgs>
+class MessageRing {
+    static constexpr std::size_t Align = 8;
+    static constexpr std::size_t Mask = CapacityBytes - 1;
+    static constexpr std::uint16_t PadTag = 0xFFFF;
+
+    static_assert(is_power_of_two(CapacityBytes), "CapacityBytes must be a power of two");
+    static_assert(sizeof...(Msgs) >= 1 && sizeof...(Msgs) < PadTag, "bad number of message types");
+    static_assert(((alignof(Msgs) <= 64) && ...), "message alignment above 64 is not supported");
+    static_assert(((sizeof(Msgs) < 0x10000) && ...), "message too large");
+
+    struct Header {
+        std::uint32_t size; // whole record, header and padding included
+        std::uint16_t tag;
+        std::uint16_t payload_offset;
+    };
+    static_assert(sizeof(Header) == Align);
+
+    template <typename M, typename First, typename... Rest>
+    static constexpr std::uint16_t index_of() noexcept {
+        if constexpr (std::is_same_v<M, First>) {
+            return 0;
+        } else {
+            static_assert(sizeof...(Rest) > 0, "type is not one of the ring's message types");
+            return static_cast<std::uint16_t>(1 + index_of<M, Rest...>());
+        }
+    }
+
+    static constexpr std::size_t round_up(std::size_t n, std::size_t a) noexcept {
+        return (n + a - 1) & ~(a - 1);
+    }
+
+public:
+    template <typename M>
+    static constexpr std::uint16_t tag_of = index_of<M, Msgs...>();
+
+    MessageRing() = default;
+
+    MessageRing(const MessageRing&) = delete;
+    MessageRing& operator=(const MessageRing&) = delete;
+
+    ~MessageRing() {
+        consume([](auto&) {}, static_cast<std::size_t>(-1));
+    }
+
+    template <typename M, class... Args>
+    bool push(Args&&... args) noexcept(std::is_nothrow_constructible_v<M, Args...>) {
+        constexpr std::uint16_t tag = tag_of<M>;
+        const auto h = head.load(std::memory_order_relaxed);
+        const std::size_t off = h & Mask;
+        std::size_t pad = 0;
+        std::size_t payload = round_up(off + sizeof(Header), alignof(M)) - off;
+        std::size_t need = round_up(payload + sizeof(M), Align);
+        if (CapacityBytes - off < need) {
+            pad = CapacityBytes - off;
+            payload = round_up(sizeof(Header), alignof(M));
+            need = round_up(payload + sizeof(M), Align);
+        }
+        if (pad + need > CapacityBytes - (h - cached_tail)) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (pad + need > CapacityBytes - (h - cached_tail)) {
+                return false;
+            }
+        }
+        if (pad) {
+            std::construct_at(header_at(h), Header{static_cast<std::uint32_t>(pad), PadTag, 0});
+        }
+        auto* hdr = std::construct_at(header_at(h + pad),
+                                      Header{static_cast<std::uint32_t>(need), tag, static_cast<std::uint16_t>(payload)});
+        std::construct_at(reinterpret_cast<M*>(reinterpret_cast<unsigned char*>(hdr) + payload),
+                          std::forward<Args>(args)...);
+        head.store(h + pad + need, std::memory_order_release);
+        return true;
+    }
+
+    // Calls visitor(Msg&) for up to max_n messages in order; returns the number consumed.
+    template <class Visitor>
+    std::size_t consume(Visitor&& visitor, std::size_t max_n = static_cast<std::size_t>(-1)) {
+        using V = std::remove_reference_t<Visitor>;
+        static constexpr std::array<void (*)(V&, void*), sizeof...(Msgs)> table{&dispatch<V, Msgs>...};
+
+        auto t = tail.load(std::memory_order_relaxed);
+        const auto h = head.load(std::memory_order_acquire);
+        std::size_t n = 0;
+        while (t != h && n < max_n) {
+            auto* hdr = header_at(t);
+            const std::uint32_t size = hdr->size;
+            if (hdr->tag != PadTag) {
+                table[hdr->tag](visitor, reinterpret_cast<unsigned char*>(hdr) + hdr->payload_offset);
+                ++n;
+            }
+            t += size;
+        }
+        tail.store(t, std::memory_order_release);
+        return n;
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+    }
+
+    // Bytes currently occupied by records, headers and padding included.
+    [[nodiscard]] std::size_t size_bytes() const noexcept {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    static constexpr std::size_t capacity_bytes() noexcept {
+        return CapacityBytes;
+    }
+
+private:
+    template <class V, typename M>
+    static void dispatch(V& visitor, void* p) {
+        auto* msg = static_cast<M*>(p);
+        visitor(*msg);
+        std::destroy_at(msg);
+    }
+
+    Header* header_at(std::size_t pos) noexcept {
+        return reinterpret_cast<Header*>(&storage[pos & Mask]);
+    }
+
+    alignas(64) unsigned char storage[CapacityBytes];
+
+    alignas(64) std::atomic<std::size_t> head{0};
+    std::size_t cached_tail = 0; // producer-only
+
+    alignas(64) std::atomic<std::size_t> tail{0};
+};
+
+}
@@ -0,0 +1,213 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// NUMA placement for heap-allocated rings, without a libnuma dependency.
+// A ring keeps its storage, head and tail inline, so placing the ring object
+// places all three: make_ring() maps fresh pages, applies the memory policy
+// with the mbind syscall and constructs the ring in place.
+// On non-Linux targets the policy is ignored and make_ring() falls back to
+// an aligned operator new.
+
+namespace rb::numa {
+
+enum class Policy {
+    first_touch, // kernel default: pages land on the node of the first thread to write them
+    bind,        // all pages on one node
+    interleave,  // pages spread round-robin over every online node
+};
+
+struct Placement {
+    Policy policy = Policy::first_touch;
+    int node = -1; // used by Policy::bind
+
+    static Placement on_node(int n) noexcept {
+        return {Policy::bind, n};
+    }
+    static Placement interleaved() noexcept {
+        return {Policy::interleave, -1};
+    }
+};
+
+// Parses the kernel's list format, e.g. "0-3,8,10-11".
+inline std::vector<int> parse_cpu_list(std::string_view s) {
+    std::vector<int> out;
+    while (!s.empty()) {
+        const auto comma = s.find(',');
+        auto item = s.substr(0, comma);
+        s = comma == std::string_view::npos ? std::string_view{} : s.substr(comma + 1);
+        while (!item.empty() && (item.back() == '\n' || item.back() == ' ')) {
+            item.remove_suffix(1);
+        }
+        if (item.empty()) {
+            continue;
+        }
+        const auto dash = item.find('-');
+        const int lo = std::stoi(std::string(item.substr(0, dash)));
+        const int hi = dash == std::string_view::npos ? lo : std::stoi(std::string(item.substr(dash + 1)));
+        for (int i = lo; i <= hi; ++i) {
+            out.push_back(i);
+        }
+    }
+    return out;
+}
+
+struct Topology {
+    std::vector<int> nodes;
+    std::vector<std::vector<int>> cpus; // cpus[i] belong to nodes[i]
+
+    // Reads /sys/devices/system/node. A machine without that directory is
+    // reported as a single node 0 with no known CPUs.
+    static Topology detect() {
+        Topology t;
+        const std::string root = "/sys/devices/system/node/";
+        std::ifstream online(root + "online");
+        std::string line;
+        if (online && std::getline(online, line)) {
+            t.nodes = parse_cpu_list(line);
+        }
+        if (t.nodes.empty()) {
+            t.nodes.push_back(0);
+        }
+        for (int n : t.nodes) {
+            std::ifstream cpulist(root + "node" + std::to_string(n) + "/cpulist");
+            std::string cpus;
+            std::getline(cpulist, cpus);
+            t.cpus.push_back(parse_cpu_list(cpus));
+        }
+        return t;
+    }
+
+    [[nodiscard]] int node_of_cpu(int cpu) const noexcept {
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            for (int c : cpus[i]) {
+                if (c == cpu) {
+                    return nodes[i];
+                }
+            }
+        }
+        return -1;
+    }
+};
+
+// Node of the CPU the caller is running on, or -1 when unknown.
+inline int current_node() noexcept {
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+        return static_cast<int>(node);
+    }
+#endif
+    return -1;
+}
+
+// Maps bytes (rounded up to whole pages) under the given placement.
+// Returns nullptr if the mapping or the policy cannot be applied. Interleaving
+// keeps the first-touch placement if the node list cannot be read.
+inline void* allocate(std::size_t bytes, const Placement& where) noexcept {
+#if defined(__linux__)
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        return nullptr;
+    }
+    if (where.policy == Policy::first_touch) {
+        return p;
+    }
+    constexpr std::size_t MaxNodes = 1024;
+    constexpr std::size_t Bits = 8 * sizeof(unsigned long);
+    std::array<unsigned long, MaxNodes / Bits> mask{};
+    int mode = MPOL_BIND;
+    if (where.policy == Policy::bind) {
+        if (where.node < 0 || static_cast<std::size_t>(where.node) >= MaxNodes) {
+            munmap(p, bytes);
+            return nullptr;
+        }
+        const auto n = static_cast<std::size_t>(where.node);
+        mask[n / Bits] |= 1UL << (n % Bits);
+    } else {
+        mode = MPOL_INTERLEAVE;
+        std::vector<int> nodes;
+        try {
+            nodes = Topology::detect().nodes;
+        } catch (...) {
+            return p; // topology unreadable (allocation or parse failure): keep first-touch placement
+        }
+        for (int n : nodes) {
+            const auto u = static_cast<std::size_t>(n);
+            if (n >= 0 && u < MaxNodes) {
+                mask[u / Bits] |= 1UL << (u % Bits);
+            }
+        }
+    }
+    if (syscall(SYS_mbind, p, bytes, mode, mask.data(), MaxNodes + 1, MPOL_MF_MOVE) != 0) {
+        munmap(p, bytes);
+        return nullptr;
+    }
+    return p;
+#else
+    (void)where;
+    return ::operator new(bytes, std::align_val_t{64}, std::nothrow);
+#endif
+}
+
+inline void deallocate(void* p, std::size_t bytes) noexcept {
+#if defined(__linux__)
+    munmap(p, bytes);
+#else
+    (void)bytes;
+    ::operator delete(p, std::align_val_t{64});
+#endif
+}
+
+template <class Ring>
+struct RingDeleter {
+    std::size_t bytes = 0;
+
+    void operator()(Ring* r) const noexcept {
+        std::destroy_at(r);
+        deallocate(r, bytes);
+    }
+};
+
+template <class Ring>
+using ring_ptr = std::unique_ptr<Ring, RingDeleter<Ring>>;
+
+// Constructs a Ring on memory placed according to where; empty on failure.
+// If the Ring constructor throws, the mapping is released and the exception propagates.
+template <class Ring, class... Args>
+ring_ptr<Ring> make_ring(const Placement& where, Args&&... args) {
+    static_assert(alignof(Ring) <= 4096, "ring alignment exceeds a page");
+    std::size_t bytes = sizeof(Ring);
+#if defined(__linux__)
+    const auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    bytes = (bytes + page - 1) / page * page;
+#endif
+    void* p = allocate(bytes, where);
+    if (!p) {
+        return ring_ptr<Ring>(nullptr, RingDeleter<Ring>{bytes});
+    }
+    Ring* r;
+    try {
+        r = ::new (p) Ring(std::forward<Args>(args)...);
+    } catch (...) {
+        deallocate(p, bytes);
+        throw;
+    }
+    return ring_ptr<Ring>(r, RingDeleter<Ring>{bytes});
+}
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "ring_buffer/ring_buffer.hpp"
+
+// Key-partitioned fan-out from one producer to N consumers.
+// Requirements:
+//  - KeyFn maps a const T& to a key that std::hash accepts.
+//  - Single producer thread calls emplace()/push()/push_bulk(); consumer i
+//    reads only partition(i).
+// Each key always hashes to the same SpscRingBuffer, so per-key order is kept
+// while different keys are processed in parallel. push_bulk() stages a whole
+// batch partition by partition and publishes each touched ring once; the
+// rings' producer-cached tails keep the common path off the consumers' lines.
+
+namespace rb {
+
+template <typename T, std::size_t N, class KeyFn, std::size_t PartitionCapacity = 4096>
+class PartitionedChannel {
+    static_assert(N >= 1, "PartitionedChannel needs at least one partition");
+
+public:
+    using ring_t = SpscRingBuffer<T, PartitionCapacity>;
+
+    explicit PartitionedChannel(KeyFn key_fn = {})
+        : rings(std::make_unique<ring_t[]>(N)), key_fn(std::move(key_fn)) {}
+
+    PartitionedChannel(const PartitionedChannel&) = delete;
+    PartitionedChannel& operator=(const PartitionedChannel&) = delete;
+
+    [[nodiscard]] std::size_t partition_of(const T& v) const {
+        const auto key = key_fn(v);
+        const auto h = static_cast<std::uint64_t>(std::hash<std::remove_const_t<decltype(key)>>{}(key));
+        // Fibonacci mix so identity hashes of strided keys still spread out.
+        const auto mixed = static_cast<std::size_t>((h * 0x9E3779B97F4A7C15ull) >> 32);
+        if constexpr (is_power_of_two(N)) {
+            return mixed & (N - 1);
+        } else {
+            return mixed % N;
+        }
+    }
+
+    bool push(const T& v) {
+        return rings[partition_of(v)].push(v);
+    }
+    bool push(T&& v) {
+        const auto p = partition_of(v);
+        return rings[p].push(std::move(v));
+    }
+
+    template <class... Args>
+    bool emplace(Args&&... args) {
+        return push(T(std::forward<Args>(args)...));
+    }
+
+    // Pushes items in order until one does not fit its partition; returns how
+    // many were pushed. Each partition's head is published once per call.
+    template <class It>
+    std::size_t push_bulk(It first, It last) {
+        std::bitset<N> touched;
+        std::size_t pushed = 0;
+        for (; first != last; ++first, ++pushed) {
+            const auto p = partition_of(*first);
+            if (!rings[p].stage(*first)) {
+                break;
+            }
+            touched.set(p);
+        }
+        for (std::size_t p = 0; p < N; ++p) {
+            if (touched.test(p)) {
+                rings[p].publish();
+            }
+        }
+        return pushed;
+    }
+
+    ring_t& partition(std::size_t i) noexcept {
+        return rings[i];
+    }
+    const ring_t& partition(std::size_t i) const noexcept {
+        return rings[i];
+    }
+
+    static constexpr std::size_t partitions() noexcept {
+        return N;
+    }
+
+private:
+    std::unique_ptr<ring_t[]> rings;
+    [[no_unique_address]] KeyFn key_fn;
+};
+
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include "ring_buffer/ring_buffer.hpp"
+
+// SPSC channel for large payloads carried in a fixed slab of pre-allocated buffers.
+// Requirements:
+//  - Single producer thread calls acquire()/send().
+//  - Single consumer thread calls receive()/release()/flush_returns().
+// Filled buffers travel producer -> consumer over a forward ring; spent buffers
+// come back over a return ring in batches of ReturnBatch. The producer reuses the
+// most recently returned buffer first, so the working set stays cache-warm and
+// steady state performs no allocation.
+
+namespace rb {
+
+template <std::size_t BufferSize, std::size_t BufferCount, std::size_t ReturnBatch = 16>
+class PooledChannel {
+    static_assert(BufferCount >= 1, "BufferCount must be >= 1");
+    static_assert(ReturnBatch >= 1 && ReturnBatch <= BufferCount, "ReturnBatch must be in [1, BufferCount]");
+
+public:
+    struct alignas(64) Buffer {
+        unsigned char data[BufferSize];
+        std::size_t size = 0;
+    };
+
+    PooledChannel()
+        : slab(std::make_unique<Buffer[]>(BufferCount)),
+          free_stack(std::make_unique<Buffer*[]>(BufferCount)),
+          free_count(BufferCount) {
+        for (std::size_t i = 0; i < BufferCount; ++i) {
+            free_stack[i] = &slab[BufferCount - 1 - i];
+        }
+    }
+
+    PooledChannel(const PooledChannel&) = delete;
+    PooledChannel& operator=(const PooledChannel&) = delete;
+
+    // Producer: returns an unused buffer, or nullptr when all of them are in flight.
+    Buffer* acquire() noexcept {
+        if (free_count == 0) {
+            free_count = returned.pop_bulk(free_stack.get(), BufferCount);
+            if (free_count == 0) {
+                return nullptr;
+            }
+        }
+        return free_stack[--free_count];
+    }
+
+    // Producer: hands a buffer obtained from acquire() to the consumer.
+    bool send(Buffer* buf, std::size_t size) noexcept {
+        buf->size = size;
+        return forward.push(buf);
+    }
+
+    // Producer: gives back a buffer that was acquired but will not be sent.
+    void discard(Buffer* buf) noexcept {
+        free_stack[free_count++] = buf;
+    }
+
+    // Consumer: next filled buffer, or nullptr when nothing is pending.
+    Buffer* receive() noexcept {
+        Buffer* buf = nullptr;
+        forward.pop(buf);
+        return buf;
+    }
+
+    std::size_t receive_bulk(Buffer** out, std::size_t max_n) noexcept {
+        return forward.pop_bulk(out, max_n);
+    }
+
+    // Consumer: queues a spent buffer for return; a full batch is published at once.
+    void release(Buffer* buf) noexcept {
+        pending[pending_count++] = buf;
+        if (pending_count == ReturnBatch) {
+            flush_returns();
+        }
+    }
+
+    // Consumer: publishes any partially filled return batch.
+    void flush_returns() noexcept {
+        // The return ring can hold every buffer, so this always fits.
+        returned.emplace_bulk(pending, pending + pending_count);
+        pending_count = 0;
+    }
+
+    static constexpr std::size_t buffer_size() noexcept {
+        return BufferSize;
+    }
+
+    static constexpr std::size_t buffer_count() noexcept {
+        return BufferCount;
+    }
+
+private:
+    std::unique_ptr<Buffer[]> slab;
+
+    SpscRingBuffer<Buffer*, BufferCount> forward;
+    SpscRingBuffer<Buffer*, BufferCount> returned;
+
+    // producer-only
+    alignas(64) std::unique_ptr<Buffer*[]> free_stack;
+    std::size_t free_count;
+
+    // consumer-only
+    alignas(64) Buffer* pending[ReturnBatch] {};
+    std::size_t pending_count = 0;
+};
+
+}
@@ -0,0 +1,199 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include "ring_buffer/ring_buffer.hpp"
+
+// Multi-lane SPSC channel: one independent SpscRingBuffer per priority lane.
+// Requirements:
+//  - Lane 0 has the highest priority; each entry of LaneCapacities sizes one lane.
+//  - Single producer thread calls push()/emplace() on any lane.
+//  - Single consumer thread calls pop()/pop_bulk()/set_weights().
+// A summary word holds one "maybe non-empty" bit per lane, so the consumer only
+// touches the rings of lanes that have seen traffic. The producer sets the bit
+// after publishing, with a locked RMW only when it finds the bit clear; the
+// consumer clears it when a lane runs dry and re-checks.
+
+namespace rb {
+
+enum class DrainPolicy {
+    strict,   // always drain the highest-priority non-empty lane first
+    weighted, // round-robin, taking up to weight[lane] items per lane per round;
+              // the round carries over between calls, so small batches still rotate
+};
+
+template <typename T, std::size_t... LaneCapacities>
+class PriorityChannel {
+    static_assert(sizeof...(LaneCapacities) >= 1, "PriorityChannel needs at least one lane");
+    static_assert(sizeof...(LaneCapacities) <= 64, "PriorityChannel supports at most 64 lanes");
+
+public:
+    static constexpr std::size_t lane_count = sizeof...(LaneCapacities);
+
+    PriorityChannel() {
+        weights.fill(1);
+        rr_left = weights[0];
+    }
+
+    PriorityChannel(const PriorityChannel&) = delete;
+    PriorityChannel& operator=(const PriorityChannel&) = delete;
+
+    template <std::size_t Lane, class... Args>
+    bool emplace(Args&&... args) noexcept(std::is_nothrow_constructible_v<T, Args...>) {
+        static_assert(Lane < lane_count, "lane index out of range");
+        if (!std::get<Lane>(lanes).emplace(std::forward<Args>(args)...)) {
+            return false;
+        }
+        mark_pending(Lane);
+        return true;
+    }
+
+    bool push(std::size_t lane, const T& v) noexcept(std::is_nothrow_copy_constructible_v<T>) {
+        return push_impl(lane, v);
+    }
+    bool push(std::size_t lane, T&& v) noexcept(std::is_nothrow_move_constructible_v<T>) {
+        return push_impl(lane, std::move(v));
+    }
+
+    bool pop(T& out) noexcept(std::is_nothrow_move_assignable_v<T> && std::is_nothrow_move_constructible_v<T>) {
+        return pop_bulk(&out, 1, DrainPolicy::strict) == 1;
+    }
+
+    std::size_t pop_bulk(T* out, std::size_t max_n, DrainPolicy policy = DrainPolicy::strict)
+        noexcept(std::is_nothrow_move_assignable_v<T> && std::is_nothrow_move_constructible_v<T>) {
+        std::size_t got = 0;
+        std::uint64_t pending = summary.load(std::memory_order_acquire);
+        if (policy == DrainPolicy::strict) {
+            while (pending != 0 && got < max_n) {
+                const auto lane = static_cast<std::size_t>(std::countr_zero(pending));
+                got += drain(lane, out + got, max_n - got);
+                pending &= pending - 1;
+            }
+            return got;
+        }
+        while (pending != 0 && got < max_n) {
+            // Next lane with traffic at or after the cursor, wrapping around.
+            const std::uint64_t ahead = pending & (~std::uint64_t{0} << rr_lane);
+            const auto lane = static_cast<std::size_t>(std::countr_zero(ahead ? ahead : pending));
+            if (lane != rr_lane) {
+                rr_lane = lane;
+                rr_left = weights[lane];
+            }
+            const std::size_t want = std::min<std::size_t>(rr_left, max_n - got);
+            const std::size_t n = drain(lane, out + got, want);
+            got += n;
+            rr_left -= static_cast<std::uint32_t>(n);
+            if (n < want) {
+                pending &= ~lane_bit(lane); // ran dry: forfeits the rest of its turn
+            }
+            if (n < want || rr_left == 0) {
+                rr_lane = lane + 1 == lane_count ? 0 : lane + 1;
+                rr_left = weights[rr_lane];
+            }
+        }
+        return got;
+    }
+
+    // Consumer-side; a weight of zero is treated as one.
+    void set_weights(const std::array<std::uint32_t, lane_count>& w) noexcept {
+        for (std::size_t i = 0; i < lane_count; ++i) {
+            weights[i] = w[i] ? w[i] : 1;
+        }
+        rr_left = weights[rr_lane];
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        std::uint64_t pending = summary.load(std::memory_order_acquire);
+        for (; pending != 0; pending &= pending - 1) {
+            if (!lane_empty(static_cast<std::size_t>(std::countr_zero(pending)))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    [[nodiscard]] std::size_t size(std::size_t lane) const noexcept {
+        std::size_t n = 0;
+        visit(lane, [&](const auto& ring) { n = ring.size(); });
+        return n;
+    }
+
+    static constexpr std::size_t capacity(std::size_t lane) noexcept {
+        constexpr std::array<std::size_t, lane_count> caps{LaneCapacities...};
+        return caps[lane];
+    }
+
+private:
+    static constexpr std::uint64_t lane_bit(std::size_t lane) noexcept {
+        return std::uint64_t{1} << lane;
+    }
+
+    template <class F>
+    void visit(std::size_t lane, F&& f) {
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            (void)((I == lane ? (f(std::get<I>(lanes)), true) : false) || ...);
+        }(std::make_index_sequence<lane_count>{});
+    }
+
+    template <class F>
+    void visit(std::size_t lane, F&& f) const {
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            (void)((I == lane ? (f(std::get<I>(lanes)), true) : false) || ...);
+        }(std::make_index_sequence<lane_count>{});
+    }
+
+    template <class U>
+    bool push_impl(std::size_t lane, U&& v) {
+        bool ok = false;
+        visit(lane, [&](auto& ring) { ok = ring.emplace(std::forward<U>(v)); });
+        if (ok) {
+            mark_pending(lane);
+        }
+        return ok;
+    }
+
+    // The fence orders the head store before the summary load, pairing with
+    // drain()'s clear-then-recheck: either this load sees the cleared bit or the
+    // recheck sees the new element. While the bit stays set the consumer's copy
+    // of the summary line is left shared instead of being taken for an RMW.
+    void mark_pending(std::size_t lane) noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if ((summary.load(std::memory_order_relaxed) & lane_bit(lane)) == 0) {
+            summary.fetch_or(lane_bit(lane), std::memory_order_release);
+        }
+    }
+
+    [[nodiscard]] bool lane_empty(std::size_t lane) const noexcept {
+        bool e = true;
+        visit(lane, [&](const auto& ring) { e = ring.empty(); });
+        return e;
+    }
+
+    // Pops up to want items from one lane. When the lane runs dry its summary bit
+    // is cleared, then restored if the producer published in the meantime.
+    std::size_t drain(std::size_t lane, T* out, std::size_t want) {
+        std::size_t n = 0;
+        visit(lane, [&](auto& ring) { n = ring.pop_bulk(out, want); });
+        if (n < want) {
+            summary.fetch_and(~lane_bit(lane), std::memory_order_acq_rel);
+            std::atomic_thread_fence(std::memory_order_seq_cst); // pairs with mark_pending()
+            if (!lane_empty(lane)) {
+                summary.fetch_or(lane_bit(lane), std::memory_order_relaxed);
+            }
+        }
+        return n;
+    }
+
+    std::tuple<SpscRingBuffer<T, LaneCapacities>...> lanes;
+    alignas(64) std::atomic<std::uint64_t> summary{0};
+    alignas(64) std::array<std::uint32_t, lane_count> weights{};
+    std::size_t rr_lane = 0;   // weighted: lane whose turn it is
+    std::uint32_t rr_left = 0; // weighted: items rr_lane may still take this turn
+};
+
+}
@@ -0,0 +1,222 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include "ring_buffer/ring_buffer.hpp"
+#include "ring_buffer/tsc.hpp"
+
+// Queue residence time tracking for SpscRingBuffer.
+// TimedSpscRingBuffer stamps every Nth message with read_tsc() in a side array
+// indexed like the ring's slots, so T is unchanged. The consumer records
+// (now - stamp) into a LatencyHistogram that a monitor thread may read at any time.
+// Requirements are those of SpscRingBuffer; the sampling interval is fixed at
+// construction because both sides must agree on which messages carry a stamp.
+
+namespace rb {
+
+// Log-linear histogram: exact below 8, then 8 sub-buckets per power of two
+// (<= 12.5% relative error). Single writer; any number of concurrent readers.
+class LatencyHistogram {
+    static constexpr unsigned SubBits = 3;
+    static constexpr std::size_t Sub = std::size_t{1} << SubBits;
+
+public:
+    static constexpr std::size_t bucket_count = Sub + (64 - SubBits) * Sub;
+
+    static constexpr std::size_t bucket_of(std::uint64_t v) noexcept {
+        if (v < Sub) {
+            return static_cast<std::size_t>(v);
+        }
+        const auto msb = static_cast<unsigned>(std::bit_width(v) - 1);
+        const auto sub = static_cast<std::size_t>((v >> (msb - SubBits)) & (Sub - 1));
+        return Sub + (msb - SubBits) * Sub + sub;
+    }
+
+    // Smallest value that falls into bucket b.
+    static constexpr std::uint64_t lower_bound(std::size_t b) noexcept {
+        if (b < Sub) {
+            return b;
+        }
+        const std::size_t msb = (b - Sub) / Sub + SubBits;
+        const std::uint64_t sub = (b - Sub) % Sub;
+        return (Sub + sub) << (msb - SubBits);
+    }
+
+    // Writer thread only.
+    void record(std::uint64_t v) noexcept {
+        bump(buckets[bucket_of(v)]);
+        bump(total);
+        if (v > max_seen.load(std::memory_order_relaxed)) {
+            max_seen.store(v, std::memory_order_relaxed);
+        }
+    }
+
+    [[nodiscard]] std::uint64_t count() const noexcept {
+        return total.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] std::uint64_t count(std::size_t bucket) const noexcept {
+        return buckets[bucket].load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] std::uint64_t max() const noexcept {
+        return max_seen.load(std::memory_order_relaxed);
+    }
+
+    // Lower bound of the bucket holding quantile q in [0, 1]; 0 when empty.
+    [[nodiscard]] std::uint64_t percentile(double q) const noexcept {
+        std::array<std::uint64_t, bucket_count> snap;
+        std::uint64_t n = 0;
+        for (std::size_t b = 0; b < bucket_count; ++b) {
+            snap[b] = buckets[b].load(std::memory_order_relaxed);
+            n += snap[b];
+        }
+        if (n == 0) {
+            return 0;
+        }
+        const auto rank = static_cast<std::uint64_t>(q * (double)(n - 1));
+        std::uint64_t seen = 0;
+        for (std::size_t b = 0; b < bucket_count; ++b) {
+            seen += snap[b];
+            if (seen > rank) {
+                return lower_bound(b);
+            }
+        }
+        return lower_bound(bucket_count - 1);
+    }
+
+private:
+    static void bump(std::atomic<std::uint64_t>& c) noexcept {
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<std::uint64_t>, bucket_count> buckets{};
+    std::atomic<std::uint64_t> total{0};
+    std::atomic<std::uint64_t> max_seen{0};
+};
+
+template <typename T, std::size_t CapacityPow2>
+class TimedSpscRingBuffer {
+    static_assert(is_power_of_two(CapacityPow2), "CapacityPow2 must be a power of two");
+    using ring_t = SpscRingBuffer<T, CapacityPow2>;
+    static constexpr std::size_t Mask = CapacityPow2 - 1;
+
+public:
+    // sample_every is rounded up to a power of two; 1 stamps every message.
+    explicit TimedSpscRingBuffer(std::size_t sample_every = 1)
+        : sample_mask(std::bit_ceil(sample_every ? sample_every : 1) - 1) {}
+
+    TimedSpscRingBuffer(const TimedSpscRingBuffer&) = delete;
+    TimedSpscRingBuffer& operator=(const TimedSpscRingBuffer&) = delete;
+
+    bool push(const T& v) noexcept(std::is_nothrow_copy_constructible_v<T>) {
+        return emplace(v);
+    }
+    bool push(T&& v) noexcept(std::is_nothrow_move_constructible_v<T>) {
+        return emplace(std::move(v));
+    }
+
+    template <class... Args>
+    bool emplace(Args&&... args) noexcept(std::is_nothrow_constructible_v<T, Args...>) {
+        if ((produced & sample_mask) == 0) {
+            // The stamp slot is only free once we know the ring has room; the
+            // release in emplace() then publishes it together with the element.
+            if (ring.full()) {
+                return false;
+            }
+            stamps[produced & Mask] = read_tsc();
+        }
+        if (!ring.emplace(std::forward<Args>(args)...)) {
+            return false;
+        }
+        ++produced;
+        return true;
+    }
+
+    bool pop(T& out) noexcept(std::is_nothrow_move_assignable_v<T> && std::is_nothrow_move_constructible_v<T>) {
+        return pop_bulk(&out, 1) == 1;
+    }
+
+    std::optional<T> try_pop() noexcept(std::is_nothrow_move_constructible_v<T>) {
+        if ((consumed & sample_mask) != 0) {
+            auto v = ring.try_pop();
+            consumed += v.has_value();
+            return v;
+        }
+        if (ring.empty()) {
+            return std::nullopt;
+        }
+        const std::uint64_t stamp = stamps[consumed & Mask];
+        auto v = ring.try_pop();
+        ++consumed;
+        hist.record(read_tsc() - stamp);
+        return v;
+    }
+
+    std::size_t pop_bulk(T* out, std::size_t max_n) noexcept(std::is_nothrow_move_assignable_v<T> && std::is_nothrow_move_constructible_v<T>) {
+        const std::size_t available = ring.size();
+        const std::size_t n = available < max_n ? available : max_n;
+        if (n == 0) {
+            return 0;
+        }
+        // Stamps must be read before the slots are released to the producer.
+        std::uint64_t sampled[CapacityPow2 > 64 ? 64 : CapacityPow2];
+        std::size_t ns = 0;
+        std::size_t first = (consumed + sample_mask) & ~sample_mask;
+        std::size_t take = n;
+        for (std::size_t s = first; s < consumed + take; s += sample_mask + 1) {
+            if (ns == std::size(sampled)) {
+                take = s - consumed;
+                break;
+            }
+            sampled[ns++] = stamps[s & Mask];
+        }
+        const std::size_t got = ring.pop_bulk(out, take);
+        consumed += got;
+        const std::uint64_t now = read_tsc();
+        for (std::size_t i = 0; i < ns; ++i) {
+            hist.record(now - sampled[i]);
+        }
+        return got;
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return ring.empty();
+    }
+
+    [[nodiscard]] bool full() const noexcept {
+        return ring.full();
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept {
+        return ring.size();
+    }
+
+    static constexpr std::size_t capacity() noexcept {
+        return CapacityPow2;
+    }
+
+    // Residence times in read_tsc() ticks; safe to read from any thread.
+    [[nodiscard]] const LatencyHistogram& histogram() const noexcept {
+        return hist;
+    }
+
+    [[nodiscard]] std::size_t sample_interval() const noexcept {
+        return sample_mask + 1;
+    }
+
+private:
+    ring_t ring;
+    std::uint64_t stamps[CapacityPow2];
+    const std::size_t sample_mask;
+
+    alignas(64) std::size_t produced = 0; // producer-only
+    alignas(64) std::size_t consumed = 0; // consumer-only
+    LatencyHistogram hist;
+};
+
+}
@@ -1,35 +1,106 @@
 #pragma once
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <type_traits>
 #include <optional>
+#include <span>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
+#include "ring_buffer/store_policy.hpp"
+#include "ring_buffer/wait_strategy.hpp"
 
 // Fixed-size lock-free SPSC ring buffer.
 // Requirements:
-//  - Capacity must be a power of two (for fast masking).
-//  - Single producer thread calls push()/emplace().
-//  - Single consumer thread calls pop()/try_pop().
+//  - Any Capacity >= 1; every slot is usable. Power-of-two capacities map the
+//    monotonic head/tail counters to slots with a mask, other capacities keep a
+//    per-side slot cursor that wraps with a conditional subtract.
+//  - Single producer thread calls push()/emplace() (and stage()/publish()).
+//  - Single consumer thread calls pop()/try_pop()/pop_bulk()/pop_bulk_wait().
 //  - T must be trivially moveable or at least movable; copy works too.
+//  - Store selects how the producer writes slots (see store_policy.hpp); the
+//    non-regular policies need a trivially copyable T.
 
 namespace rb {
 
+inline void prefetch_read(const void* p) noexcept {
+#if defined(__GNUC__)
+    __builtin_prefetch(p, 0, 3);
+#else
+    (void)p;
+#endif
+}
+
 constexpr bool is_power_of_two(std::size_t x) {
     return x && ((x & (x - 1)) == 0);
 }
 
-template <typename T, std::size_t CapacityPow2>
+// Producer-side congestion callback: congested is true when depth reached the
+// high watermark and false once it fell back to the low watermark.
+using watermark_callback_t = void (*)(void* ctx, bool congested) noexcept;
+
+// Up to two contiguous runs of ring slots; second is non-empty only when the
+// range wraps around the end of the storage.
+template <typename T>
+struct SpanPair {
+    std::span<T> first;
+    std::span<T> second;
+
+    [[nodiscard]] std::size_t size() const noexcept {
+        return first.size() + second.size();
+    }
+};
+
+// Constructor tag: leave the slot storage uninitialized instead of zeroing it.
+struct no_zero_init_t {
+    explicit no_zero_init_t() = default;
+};
+inline constexpr no_zero_init_t no_zero_init{};
+
+template <typename T, std::size_t RingCapacity, StorePolicy Store = StorePolicy::regular>
 class SpscRingBuffer {
-    static_assert(is_power_of_two(CapacityPow2), "CapacityPow2 must be a power of two");
-    static_assert(CapacityPow2 >= 2, "CapacityPow2 must be >= 2");
-    using self_t = SpscRingBuffer<T, CapacityPow2>;
+    static_assert(RingCapacity >= 1, "RingCapacity must be >= 1");
+    static_assert(Store == StorePolicy::regular || std::is_trivially_copyable_v<T>,
+                  "non-regular StorePolicy needs a trivially copyable T");
+    using self_t = SpscRingBuffer<T, RingCapacity, Store>;
+
+    static constexpr std::size_t Capacity = RingCapacity;
+    static constexpr std::size_t Mask = RingCapacity - 1;
+    static constexpr bool Pow2 = is_power_of_two(RingCapacity);
 
-    static constexpr std::size_t Capacity = CapacityPow2;
-    static constexpr std::size_t Mask = CapacityPow2 - 1;
+    static std::size_t slot_of(std::size_t counter, std::size_t cursor) noexcept {
+        if constexpr (Pow2) {
+            (void)cursor;
+            return counter & Mask;
+        } else {
+            (void)counter;
+            return cursor;
+        }
+    }
+
+    static void advance(std::size_t& cursor, std::size_t n) noexcept {
+        if constexpr (Pow2) {
+            (void)cursor;
+            (void)n;
+        } else {
+            cursor += n;
+            if (cursor >= Capacity) {
+                cursor -= Capacity;
+            }
+        }
+    }
 
 public:
-    SpscRingBuffer() : head(0), tail(0) {}
+    using value_type = T;
+
+    SpscRingBuffer() : storage{}, head(0), tail(0) {}
+
+    // Skips the memset of storage; slots are always constructed before they are read.
+    explicit SpscRingBuffer(no_zero_init_t) noexcept : head(0), tail(0) {}
 
     SpscRingBuffer(const SpscRingBuffer&) = delete;
     SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
@@ -43,27 +114,69 @@ public:
 
     template <class... Args>
     bool emplace(Args&&... args) noexcept(std::is_nothrow_constructible_v<T, Args...>) {
-        const auto head_loaded = head.load(std::memory_order_relaxed);
-        const auto next = head_loaded + 1;
-        if (next - tail.load(std::memory_order_acquire) > Capacity - 1) {
+        if (!stage(std::forward<Args>(args)...)) {
             return false;
         }
-        std::size_t idx = (head_loaded & Mask);
+        publish();
+        return true;
+    }
+
+    // Producer: writes the next element without making it visible; publish()
+    // (or any publishing producer call) releases every staged element at once.
+    template <class... Args>
+    bool stage(Args&&... args) noexcept(std::is_nothrow_constructible_v<T, Args...>) {
+        const auto next = write_head + 1;
+        if (next - cached_tail > Capacity) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (next - cached_tail > Capacity) {
+                return false;
+            }
+        }
+        std::size_t idx = slot_of(write_head, head_slot);
         auto* slot = reinterpret_cast<T*>(&storage[idx * sizeof(T)]);
-        std::construct_at(slot, std::forward<Args>(args)...);
-        head.store(next, std::memory_order_release);
+        write_slot(slot, std::forward<Args>(args)...);
+        advance(head_slot, 1);
+        write_head = next;
         return true;
     }
 
+    // Producer: publishes everything staged so far with a single release store.
+    void publish() noexcept {
+        before_publish();
+        head.store(write_head, std::memory_order_release);
+        if (write_head - cached_tail >= watermark_trip) [[unlikely]] {
+            update_watermarks(write_head);
+        }
+    }
+
+    // Producer-only: elements staged but not yet published.
+    [[nodiscard]] std::size_t staged() const noexcept {
+        return write_head - head.load(std::memory_order_relaxed);
+    }
+
+    // Producer-only: elements written and not yet consumed, staged ones included.
+    // Reloads the shared tail, so call it once per batch rather than per element.
+    std::size_t producer_depth() noexcept {
+        cached_tail = tail.load(std::memory_order_acquire);
+        return write_head - cached_tail;
+    }
+
+    // Producer-only: producer_depth() as of the last tail reload. An upper bound
+    // that touches no shared line.
+    [[nodiscard]] std::size_t cached_depth() const noexcept {
+        return write_head - cached_tail;
+    }
+
     bool pop(T& out) noexcept(std::is_nothrow_move_assignable_v<T> && std::is_nothrow_move_constructible_v<T>) {
         const auto tail_loaded = tail.load(std::memory_order_relaxed);
         if (tail_loaded == head.load(std::memory_order_acquire)) {
             return false;
         }
-        std::size_t idx = (tail_loaded & Mask);
+        std::size_t idx = slot_of(tail_loaded, tail_slot);
         auto* slot = reinterpret_cast<T*>(&storage[idx * sizeof(T)]);
         out = std::move(*slot);
         std::destroy_at(slot);
+        advance(tail_slot, 1);
         tail.store(tail_loaded + 1, std::memory_order_release);
         return true;
     }
@@ -73,10 +186,11 @@ public:
         if (tail_loaded == head.load(std::memory_order_acquire)) {
             return std::nullopt;
         }
-        std::size_t idx = (tail_loaded & Mask);
+        std::size_t idx = slot_of(tail_loaded, tail_slot);
         auto* slot = reinterpret_cast<T*>(&storage[idx * sizeof(T)]);
         std::optional<T> ret{std::move(*slot)};
         std::destroy_at(slot);
+        advance(tail_slot, 1);
         tail.store(tail_loaded + 1, std::memory_order_release);
         return ret;
     }
@@ -86,7 +200,7 @@ public:
     }
 
     [[nodiscard]] bool full() const noexcept {
-        return (head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire)) >= (Capacity - 1);
+        return (head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire)) >= Capacity;
     }
 
     [[nodiscard]] std::size_t size() const noexcept {
@@ -111,12 +225,75 @@ public:
         if (tail_loaded == head.load(std::memory_order_acquire)) {
             return false;
         }
-        const std::size_t idx = (tail_loaded & Mask);
+        const std::size_t idx = slot_of(tail_loaded, tail_slot);
         auto* slot = reinterpret_cast<const T*>(&storage[idx * sizeof(T)]);
         out = *slot;
         return true;
     }
 
+    // Writes one byte per 4 KiB of storage so the page faults happen now instead of
+    // during the first lap. Call before the ring is in use, from the thread whose
+    // NUMA node should own the pages under first-touch placement.
+    void prefault() noexcept {
+        constexpr std::size_t Stride = 4096;
+        for (std::size_t i = 0; i < sizeof(storage); i += Stride) {
+            static_cast<volatile unsigned char&>(storage[i]) = 0;
+        }
+        static_cast<volatile unsigned char&>(storage[sizeof(storage) - 1]) = 0;
+    }
+
+    // Pins the whole ring in RAM. Returns false where unsupported or when
+    // RLIMIT_MEMLOCK does not allow it.
+    bool lock_memory() noexcept {
+#if defined(__unix__) || defined(__APPLE__)
+        return mlock(this, sizeof(*this)) == 0;
+#else
+        return false;
+#endif
+    }
+
+    // Producer-side backpressure. Once depth reaches high the ring is congested
+    // until depth drops to low (hysteresis); each transition invokes cb(ctx, state).
+    // While not congested the check costs one compare against the producer's
+    // cached tail. A producer that stops pushing should call poll_watermarks()
+    // to notice the drain. high > Capacity disables the check (the default).
+    void set_watermarks(std::size_t high, std::size_t low, watermark_callback_t cb = nullptr, void* ctx = nullptr) noexcept {
+        high_mark = high;
+        low_mark = low < high ? low : (high ? high - 1 : 0);
+        on_watermark = cb;
+        watermark_ctx = ctx;
+        congested_state = false;
+        watermark_trip = high;
+    }
+
+    // Producer-only.
+    [[nodiscard]] bool congested() const noexcept {
+        return congested_state;
+    }
+
+    // Producer-only: refreshes the depth estimate and returns congested().
+    bool poll_watermarks() noexcept {
+        update_watermarks(write_head);
+        return congested_state;
+    }
+
+    // Consumer: waits until at least min_n elements are readable or the deadline
+    // passes, idling with wait between polls, then pops up to max_n. Returns the
+    // number popped, which is below min_n only on timeout.
+    template <class Wait = BackoffWait>
+    std::size_t pop_bulk_wait(T* out, std::size_t min_n, std::size_t max_n,
+                              std::chrono::steady_clock::time_point deadline, Wait wait = {}) {
+        min_n = min_n < max_n ? min_n : max_n;
+        min_n = min_n < Capacity ? min_n : Capacity;
+        const auto tail_loaded = tail.load(std::memory_order_relaxed);
+        wait.reset();
+        while (head.load(std::memory_order_acquire) - tail_loaded < min_n
+               && std::chrono::steady_clock::now() < deadline) {
+            wait();
+        }
+        return pop_bulk(out, max_n);
+    }
+
     std::size_t pop_bulk(T* out, std::size_t max_n) noexcept(std::is_nothrow_move_assignable_v<T> && std::is_nothrow_move_constructible_v<T>) {
         const auto tail_loaded = tail.load(std::memory_order_relaxed);
         const auto head_loaded = head.load(std::memory_order_acquire);
@@ -125,10 +302,11 @@ public:
             return 0;
         }
         std::size_t to_pop = (available < max_n) ? available : max_n;
-        std::size_t idx = (tail_loaded & Mask);
+        std::size_t idx = slot_of(tail_loaded, tail_slot);
         std::size_t first = ((Capacity - idx) < to_pop) ? (Capacity - idx) : to_pop;
 
         for (std::size_t i = 0; i < first; ++i) {
+            prefetch_ahead(idx + i);
             auto* slot = reinterpret_cast<T*>(&storage[(idx + i) * sizeof(T)]);
             out[i] = std::move(*slot);
             std::destroy_at(slot);
@@ -136,21 +314,24 @@ public:
         std::size_t popped = first;
         if (popped < to_pop) {
             for (std::size_t i = 0; i < to_pop - first; ++i) {
+                prefetch_ahead(i);
                 auto* slot = reinterpret_cast<T*>(&storage[i * sizeof(T)]);
                 out[popped + i] = std::move(*slot);
                 std::destroy_at(slot);
             }
         }
+        advance(tail_slot, to_pop);
         tail.store(tail_loaded + to_pop, std::memory_order_release);
         return to_pop;
     }
 
     template<class InputIt>
     std::size_t emplace_bulk(InputIt first, InputIt last) noexcept(noexcept(std::declval<T&>() = *first) || std::is_nothrow_move_constructible_v<T>) {
-        const auto head_loaded = head.load(std::memory_order_relaxed);
+        const auto head_loaded = write_head;
         const auto tail_loaded = tail.load((std::memory_order_acquire));
+        cached_tail = tail_loaded;
         const std::size_t used = head_loaded - tail_loaded;
-        const std::size_t free_slots = Capacity - 1 - used;
+        const std::size_t free_slots = Capacity - used;
         if (free_slots == 0) {
             return 0;
         }
@@ -162,29 +343,163 @@ public:
             return 0;
         }
         const std::size_t to_push = (want_to_push < free_slots) ? want_to_push : free_slots;
-        std::size_t idx = (head_loaded & Mask);
+        std::size_t idx = slot_of(head_loaded, head_slot);
         std::size_t first_run = ((Capacity - idx) < to_push) ? (Capacity - idx) : to_push;
 
         {
             auto it = first;
             for (std::size_t i = 0; i < first_run; ++i, ++it) {
                 auto* slot = reinterpret_cast<T*>(&storage[(idx + i) * sizeof(T)]);
-                std::construct_at(slot, *it);
+                write_slot(slot, *it);
             }
             for (std::size_t i = 0; i < to_push - first_run; ++i, ++it) {
                 auto* slot = reinterpret_cast<T*>(&storage[i * sizeof(T)]);
-                std::construct_at(slot, *it);
+                write_slot(slot, *it);
             }
         }
-        head.store(head_loaded + to_push, std::memory_order_release);
+        advance(head_slot, to_push);
+        write_head = head_loaded + to_push;
+        publish();
         return to_push;
     }
 
+    // Consumer: the oldest readable elements (at most max_n) in place. Elements may
+    // be inspected or moved from; nothing is freed until release().
+    SpanPair<T> read_spans(std::size_t max_n = static_cast<std::size_t>(-1)) noexcept {
+        const auto tail_loaded = tail.load(std::memory_order_relaxed);
+        const std::size_t available = head.load(std::memory_order_acquire) - tail_loaded;
+        const std::size_t n = available < max_n ? available : max_n;
+        const std::size_t idx = slot_of(tail_loaded, tail_slot);
+        // Get the first prefetch-distance lines of the run in flight together.
+        const std::size_t span_bytes = n * sizeof(T);
+        for (std::size_t a = 0; a < prefetch_bytes && a < span_bytes; a += 64) {
+            prefetch_read(&storage[wrap_byte(idx * sizeof(T) + a)]);
+        }
+        return runs(idx, n);
+    }
+
+    // Consumer: how many cache lines ahead pop_bulk() prefetches, and how many
+    // lines read_spans() prefetches from the start of its run. 0 (the default) disables it.
+    void set_prefetch_distance(std::size_t lines) noexcept {
+        prefetch_bytes = lines * 64 < sizeof(storage) ? lines * 64 : sizeof(storage);
+    }
+
+    // Consumer: destroys the oldest n elements (n <= read_spans().size()) and
+    // publishes their slots with a single tail store.
+    void release(std::size_t n) noexcept {
+        const auto tail_loaded = tail.load(std::memory_order_relaxed);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            const auto spans = runs(slot_of(tail_loaded, tail_slot), n);
+            std::destroy(spans.first.begin(), spans.first.end());
+            std::destroy(spans.second.begin(), spans.second.end());
+        }
+        advance(tail_slot, n);
+        tail.store(tail_loaded + n, std::memory_order_release);
+    }
+
+    // Producer: up to max_n free slots to write in place, for trivially copyable T.
+    // Nothing is visible to the consumer until commit().
+    SpanPair<T> reserve(std::size_t max_n = static_cast<std::size_t>(-1)) noexcept {
+        static_assert(std::is_trivially_copyable_v<T>, "reserve() needs a trivially copyable T");
+        const auto head_loaded = write_head;
+        if (Capacity - (head_loaded - cached_tail) < max_n) {
+            cached_tail = tail.load(std::memory_order_acquire);
+        }
+        const std::size_t free_slots = Capacity - (head_loaded - cached_tail);
+        return runs(slot_of(head_loaded, head_slot), free_slots < max_n ? free_slots : max_n);
+    }
+
+    // Producer: publishes the first n reserved slots (n <= reserve().size()).
+    void commit(std::size_t n) noexcept {
+        advance(head_slot, n);
+        write_head += n;
+        publish();
+    }
+
 private:
-    alignas(alignof(T)) unsigned char storage[Capacity * sizeof(T)] {};
+    template <class... Args>
+    static void write_slot(T* slot, Args&&... args) {
+        if constexpr (Store == StorePolicy::streaming) {
+            if constexpr (sizeof...(Args) == 1 && (std::is_same_v<std::remove_cvref_t<Args>, T> && ...)) {
+                (detail::stream_copy(slot, std::addressof(args), sizeof(T)), ...);
+            } else {
+                const T tmp(std::forward<Args>(args)...);
+                detail::stream_copy(slot, std::addressof(tmp), sizeof(T));
+            }
+        } else {
+            std::construct_at(slot, std::forward<Args>(args)...);
+            if constexpr (Store == StorePolicy::demote) {
+                detail::demote_lines(slot, sizeof(T));
+            }
+        }
+    }
+
+    static constexpr std::size_t wrap_byte(std::size_t off) noexcept {
+        return off >= sizeof(storage) ? off - sizeof(storage) : off;
+    }
+
+    // Prefetches every line that starts within prefetch_bytes ahead of slot idx;
+    // walking consecutive slots touches each line exactly once.
+    void prefetch_ahead(std::size_t idx) const noexcept {
+        if (prefetch_bytes == 0) {
+            return;
+        }
+        const std::size_t off = idx * sizeof(T) + prefetch_bytes;
+        for (std::size_t a = (off + 63) & ~std::size_t{63}; a < off + sizeof(T); a += 64) {
+            prefetch_read(&storage[wrap_byte(a)]);
+        }
+    }
+
+    static void before_publish() noexcept {
+        if constexpr (Store == StorePolicy::streaming) {
+            detail::stream_fence();
+        }
+    }
+
+    SpanPair<T> runs(std::size_t idx, std::size_t n) noexcept {
+        auto* base = reinterpret_cast<T*>(storage);
+        const std::size_t first_run = (Capacity - idx) < n ? (Capacity - idx) : n;
+        return {std::span<T>(base + idx, first_run), std::span<T>(base, n - first_run)};
+    }
+
+    void update_watermarks(std::size_t head_now) noexcept {
+        if (high_mark > Capacity) {
+            return;
+        }
+        cached_tail = tail.load(std::memory_order_acquire);
+        const std::size_t depth = head_now - cached_tail;
+        if (!congested_state && depth >= high_mark) {
+            congested_state = true;
+            watermark_trip = 0; // re-check on every push until drained
+        } else if (congested_state && depth <= low_mark) {
+            congested_state = false;
+            watermark_trip = high_mark;
+        } else {
+            return;
+        }
+        if (on_watermark) {
+            on_watermark(watermark_ctx, congested_state);
+        }
+    }
+
+    alignas(alignof(T)) unsigned char storage[Capacity * sizeof(T)];
 
     alignas(64) std::atomic<std::size_t> head;
+    // producer-only, on its own line: stage() writes it per element while the consumer polls head
+    alignas(64) std::size_t write_head = 0; // head including staged, unpublished elements
+    std::size_t head_slot = 0; // head's slot when Capacity is not a power of two
+    std::size_t cached_tail = 0;
+    std::size_t watermark_trip = static_cast<std::size_t>(-1);
+    std::size_t high_mark = static_cast<std::size_t>(-1);
+    std::size_t low_mark = 0;
+    watermark_callback_t on_watermark = nullptr;
+    void* watermark_ctx = nullptr;
+    bool congested_state = false;
+
     alignas(64) std::atomic<std::size_t> tail;
+    // consumer-only
+    std::size_t tail_slot = 0; // tail's slot when Capacity is not a power of two
+    std::size_t prefetch_bytes = 0;
 };
 
 }
@@ -0,0 +1,147 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "ring_buffer/ring_buffer.hpp"
+
+// Struct-of-arrays SPSC ring: one column per field, shared head/tail.
+// Requirements:
+//  - CapacityPow2 must be a power of two (for fast masking).
+//  - Every field type must be trivially copyable.
+//  - Single producer thread calls push(); single consumer thread calls
+//    pop()/read_spans()/release().
+// Each column is a contiguous, 64-byte aligned array, so a consumer that only
+// scans one or two fields can run SIMD kernels straight over the spans that
+// read_spans() returns instead of striding through whole records.
+
+namespace rb {
+
+template <std::size_t CapacityPow2, typename... Fields>
+class SoaRingBuffer {
+    static_assert(is_power_of_two(CapacityPow2), "CapacityPow2 must be a power of two");
+    static_assert(sizeof...(Fields) >= 1, "SoaRingBuffer needs at least one field");
+    static_assert((std::is_trivially_copyable_v<Fields> && ...), "fields must be trivially copyable");
+
+    static constexpr std::size_t Capacity = CapacityPow2;
+    static constexpr std::size_t Mask = CapacityPow2 - 1;
+
+    template <typename F>
+    struct alignas(64) Column {
+        F data[Capacity];
+    };
+
+public:
+    // Readable elements as up to two contiguous runs per column (the second one
+    // is non-empty only when the range wraps around the end of the ring).
+    struct Spans {
+        std::tuple<std::span<const Fields>...> first;
+        std::tuple<std::span<const Fields>...> second;
+
+        [[nodiscard]] std::size_t size() const noexcept {
+            return std::get<0>(first).size() + std::get<0>(second).size();
+        }
+
+        template <std::size_t I>
+        [[nodiscard]] auto column_first() const noexcept {
+            return std::get<I>(first);
+        }
+
+        template <std::size_t I>
+        [[nodiscard]] auto column_second() const noexcept {
+            return std::get<I>(second);
+        }
+    };
+
+    SoaRingBuffer() = default;
+
+    SoaRingBuffer(const SoaRingBuffer&) = delete;
+    SoaRingBuffer& operator=(const SoaRingBuffer&) = delete;
+
+    bool push(const Fields&... values) noexcept {
+        const auto head_loaded = head.load(std::memory_order_relaxed);
+        if (head_loaded - cached_tail >= Capacity) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (head_loaded - cached_tail >= Capacity) {
+                return false;
+            }
+        }
+        const std::size_t idx = head_loaded & Mask;
+        store(idx, std::index_sequence_for<Fields...>{}, values...);
+        head.store(head_loaded + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(Fields&... out) noexcept {
+        const auto tail_loaded = tail.load(std::memory_order_relaxed);
+        if (tail_loaded == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        const std::size_t idx = tail_loaded & Mask;
+        load(idx, std::index_sequence_for<Fields...>{}, out...);
+        tail.store(tail_loaded + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: views of up to max_n readable elements. Nothing is released
+    // until release() is called.
+    Spans read_spans(std::size_t max_n = Capacity) const noexcept {
+        const auto tail_loaded = tail.load(std::memory_order_relaxed);
+        const std::size_t available = head.load(std::memory_order_acquire) - tail_loaded;
+        const std::size_t n = available < max_n ? available : max_n;
+        const std::size_t idx = tail_loaded & Mask;
+        const std::size_t first_run = (Capacity - idx) < n ? (Capacity - idx) : n;
+        return spans(idx, first_run, n - first_run, std::index_sequence_for<Fields...>{});
+    }
+
+    // Consumer: hands the oldest n elements (n <= last read_spans().size()) back to the producer.
+    void release(std::size_t n) noexcept {
+        tail.store(tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    template <std::size_t I>
+    [[nodiscard]] const auto& column() const noexcept {
+        return std::get<I>(columns).data;
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    static constexpr std::size_t capacity() noexcept {
+        return Capacity;
+    }
+
+private:
+    template <std::size_t... I>
+    void store(std::size_t idx, std::index_sequence<I...>, const Fields&... values) noexcept {
+        ((std::get<I>(columns).data[idx] = values), ...);
+    }
+
+    template <std::size_t... I>
+    void load(std::size_t idx, std::index_sequence<I...>, Fields&... out) const noexcept {
+        ((out = std::get<I>(columns).data[idx]), ...);
+    }
+
+    template <std::size_t... I>
+    Spans spans(std::size_t idx, std::size_t first_run, std::size_t second_run, std::index_sequence<I...>) const noexcept {
+        return Spans{
+            {std::span<const Fields>(std::get<I>(columns).data + idx, first_run)...},
+            {std::span<const Fields>(std::get<I>(columns).data, second_run)...},
+        };
+    }
+
+    std::tuple<Column<Fields>...> columns;
+
+    alignas(64) std::atomic<std::size_t> head{0};
+    std::size_t cached_tail = 0; // producer-only
+    alignas(64) std::atomic<std::size_t> tail{0};
+};
+
+}
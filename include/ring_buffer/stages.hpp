@@ -0,0 +1,188 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+#include "ring_buffer/ring_buffer.hpp"
+
+// Ring-to-ring pipeline stages for trivially copyable payloads.
+// Both stages read the source's contiguous spans (read_spans) and write straight
+// into the destination's reserved slots (reserve), then publish each index once
+// per batch (commit/release) instead of once per message.
+// filter_into() evaluates the predicate 8 elements at a time and compacts the
+// matches with AVX-512 compress stores or an AVX2 permutation when the build
+// enables them (-mavx512f -mavx512vl / -mavx2), and a branchless scalar loop otherwise.
+// Src and Dst may be any ring with that span API, e.g. SpscRingBuffer.
+
+namespace rb {
+
+struct StageResult {
+    std::size_t consumed = 0; // items taken from the source
+    std::size_t produced = 0; // items published to the destination
+};
+
+namespace detail {
+
+#if defined(__AVX2__) && !(defined(__AVX512F__) && defined(__AVX512VL__))
+// For each 8-bit keep mask, the lane indices of the kept elements, packed to the front.
+inline constexpr auto compress_lut = [] {
+    std::array<std::array<std::int32_t, 8>, 256> lut{};
+    for (unsigned m = 0; m < 256; ++m) {
+        int w = 0;
+        for (int j = 0; j < 8; ++j) {
+            if (m & (1u << j)) {
+                lut[m][static_cast<std::size_t>(w++)] = j;
+            }
+        }
+    }
+    return lut;
+}();
+#endif
+
+// Copies the elements of in[0..8) selected by keep to out and returns how many.
+// out must have room for 8 elements: some paths store a full vector.
+template <typename T>
+inline std::size_t compress8(const T* in, unsigned keep, T* out) noexcept {
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+    if constexpr (sizeof(T) == 4) {
+        _mm256_mask_compressstoreu_epi32(out, static_cast<__mmask8>(keep),
+                                         _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in)));
+        return static_cast<std::size_t>(std::popcount(keep));
+    } else if constexpr (sizeof(T) == 8) {
+        _mm512_mask_compressstoreu_epi64(out, static_cast<__mmask8>(keep), _mm512_loadu_si512(in));
+        return static_cast<std::size_t>(std::popcount(keep));
+    }
+#elif defined(__AVX2__)
+    if constexpr (sizeof(T) == 4) {
+        const auto idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(compress_lut[keep].data()));
+        const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_permutevar8x32_epi32(v, idx));
+        return static_cast<std::size_t>(std::popcount(keep));
+    }
+#endif
+    std::size_t w = 0;
+    for (unsigned j = 0; j < 8; ++j) {
+        std::memcpy(&out[w], &in[j], sizeof(T));
+        w += (keep >> j) & 1u;
+    }
+    return w;
+}
+
+// Sequential writer over a destination SpanPair.
+template <typename T>
+struct OutCursor {
+    SpanPair<T> spans;
+    std::size_t pos = 0;
+
+    [[nodiscard]] std::size_t room() const noexcept {
+        return spans.size() - pos;
+    }
+    [[nodiscard]] std::size_t contiguous_room() const noexcept {
+        return pos < spans.first.size() ? spans.first.size() - pos : spans.size() - pos;
+    }
+    T* here() noexcept {
+        return pos < spans.first.size() ? spans.first.data() + pos : spans.second.data() + (pos - spans.first.size());
+    }
+    void put(const T& v) noexcept {
+        std::memcpy(here(), &v, sizeof(T));
+        ++pos;
+    }
+};
+
+// Pointer to element off of a SpanPair and the number of elements contiguous from there.
+template <typename T>
+inline std::pair<T*, std::size_t> at(const SpanPair<T>& s, std::size_t off) noexcept {
+    if (off < s.first.size()) {
+        return {s.first.data() + off, s.first.size() - off};
+    }
+    return {s.second.data() + (off - s.first.size()), s.size() - off};
+}
+
+}
+
+// Moves up to max_n items from src to dst, keeping those for which pred(item) is
+// true. Stops early, in order, when dst runs out of room. pred must be pure: it
+// may be evaluated more than once for the item where the batch stops.
+template <class Src, class Dst, class Pred>
+StageResult filter_into(Src& src, Dst& dst, Pred&& pred, std::size_t max_n = static_cast<std::size_t>(-1)) {
+    const auto in = src.read_spans(max_n);
+    if (in.size() == 0) {
+        return {};
+    }
+    using T = std::remove_const_t<typename decltype(in.first)::element_type>;
+    static_assert(std::is_trivially_copyable_v<T>, "filter_into() needs a trivially copyable payload");
+    detail::OutCursor<T> out{dst.reserve(in.size())};
+
+    std::size_t consumed = 0;
+    for (const auto run : {in.first, in.second}) {
+        std::size_t i = 0;
+        for (; i + 8 <= run.size(); i += 8) {
+            unsigned keep = 0;
+            for (unsigned j = 0; j < 8; ++j) {
+                keep |= static_cast<unsigned>(static_cast<bool>(pred(run[i + j]))) << j;
+            }
+            const auto kept = static_cast<std::size_t>(std::popcount(keep));
+            if (out.contiguous_room() >= 8) {
+                out.pos += detail::compress8(run.data() + i, keep, out.here());
+            } else if (out.room() >= kept) {
+                for (unsigned j = 0; j < 8; ++j) {
+                    if (keep & (1u << j)) {
+                        out.put(run[i + j]);
+                    }
+                }
+            } else {
+                break;
+            }
+            consumed += 8;
+        }
+        // Rest of the run, or the chunk that did not fit: element by element.
+        for (; i < run.size(); ++i) {
+            if (pred(run[i])) {
+                if (out.room() == 0) {
+                    break;
+                }
+                out.put(run[i]);
+            }
+            ++consumed;
+        }
+        if (i < run.size()) {
+            break;
+        }
+    }
+    dst.commit(out.pos);
+    src.release(consumed);
+    return {consumed, out.pos};
+}
+
+// Moves up to max_n items from src to dst as fn(item), stopping when dst is full.
+template <class Src, class Dst, class Fn>
+StageResult transform_into(Src& src, Dst& dst, Fn&& fn, std::size_t max_n = static_cast<std::size_t>(-1)) {
+    const auto in = src.read_spans(max_n);
+    if (in.size() == 0) {
+        return {};
+    }
+    const auto out = dst.reserve(in.size());
+    const std::size_t n = out.size();
+    std::size_t done = 0;
+    while (done < n) {
+        const auto [ip, ilen] = detail::at(in, done);
+        const auto [op, olen] = detail::at(out, done);
+        std::size_t len = ilen < olen ? ilen : olen;
+        len = len < n - done ? len : n - done;
+        for (std::size_t k = 0; k < len; ++k) {
+            op[k] = fn(ip[k]);
+        }
+        done += len;
+    }
+    dst.commit(n);
+    src.release(n);
+    return {n, n};
+}
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+// How the producer writes slots of a trivially copyable T.
+//  - regular:   plain stores; the line ends up in the producer's cache.
+//  - streaming: non-temporal stores that bypass the producer's cache, so the
+//               consumer's fetch does not have to snoop it out of another core.
+//  - demote:    plain stores followed by CLDEMOTE, pushing the lines towards
+//               the shared cache; a no-op where the CPU lacks the instruction.
+// streaming and demote only pay off for large elements (a few cache lines);
+// bench/bench.cpp compares them per element size. Non-x86 targets treat both
+// as regular.
+
+namespace rb {
+
+enum class StorePolicy {
+    regular,
+    streaming,
+    demote,
+};
+
+namespace detail {
+
+inline bool cpu_has_cldemote() noexcept {
+#if defined(__GNUC__) && defined(__x86_64__)
+    static const bool has = [] {
+        unsigned a = 0, b = 0, c = 0, d = 0;
+        if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+            return false;
+        }
+        return (c & (1u << 25)) != 0;
+    }();
+    return has;
+#else
+    return false;
+#endif
+}
+
+// Copies bytes from src to dst, a slot aligned to at least 8, with non-temporal
+// stores where alignment allows. The caller must issue stream_fence() before
+// publishing the slot.
+inline void stream_copy(void* dst, const void* src, std::size_t bytes) noexcept {
+#if defined(__GNUC__) && defined(__x86_64__)
+    auto* d = static_cast<unsigned char*>(dst);
+    auto* s = static_cast<const unsigned char*>(src);
+    std::size_t i = 0;
+    if ((reinterpret_cast<std::uintptr_t>(d) & 15) == 0) {
+        for (; i + 16 <= bytes; i += 16) {
+            _mm_stream_si128(reinterpret_cast<__m128i*>(d + i),
+                             _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i)));
+        }
+    }
+    if ((reinterpret_cast<std::uintptr_t>(d + i) & 7) == 0) {
+        for (; i + 8 <= bytes; i += 8) {
+            long long v;
+            std::memcpy(&v, s + i, 8);
+            _mm_stream_si64(reinterpret_cast<long long*>(d + i), v);
+        }
+    }
+    std::memcpy(d + i, s + i, bytes - i);
+#else
+    std::memcpy(dst, src, bytes);
+#endif
+}
+
+// Orders earlier non-temporal stores before the release store that publishes them.
+inline void stream_fence() noexcept {
+#if defined(__GNUC__) && defined(__x86_64__)
+    _mm_sfence();
+#endif
+}
+
+inline void demote_lines(const void* p, std::size_t bytes) noexcept {
+#if defined(__GNUC__) && defined(__x86_64__)
+    if (!cpu_has_cldemote()) {
+        return;
+    }
+    auto addr = reinterpret_cast<std::uintptr_t>(p) & ~std::uintptr_t{63};
+    const auto end = reinterpret_cast<std::uintptr_t>(p) + bytes;
+    for (; addr < end; addr += 64) {
+        asm volatile("cldemote (%0)" ::"r"(addr) : "memory");
+    }
+#else
+    (void)p;
+    (void)bytes;
+#endif
+}
+
+}
+
+}
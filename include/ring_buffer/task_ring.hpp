@@ -0,0 +1,206 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "ring_buffer/inline_callable.hpp"
+#include "ring_buffer/ring_buffer.hpp"
+
+// Lock-free SPSC ring of type-erased callables stored in place.
+// Requirements:
+//  - CapacityBytes must be a power of two (for fast masking).
+//  - Single producer thread calls push(); single consumer thread calls run_one()/run_bulk().
+//  - Callables must be invocable as void() and must not throw.
+// Each record is a 16-byte header (ops pointer + record size) followed by the
+// callable. Callables up to InlineCapture bytes live in the ring itself; larger
+// ones are placed in one of SpillBlocks pre-allocated blocks of SpillBlockSize
+// bytes, which the consumer hands back to the producer over a free-block ring.
+// Running a task is a single indirect call through detail::callable_ops.
+
+namespace rb {
+
+template <std::size_t CapacityBytes,
+          std::size_t InlineCapture = 64,
+          std::size_t SpillBlocks = 64,
+          std::size_t SpillBlockSize = 512>
+class TaskRing {
+    static constexpr std::size_t Align = 16;
+    static constexpr std::size_t Mask = CapacityBytes - 1;
+
+    static_assert(is_power_of_two(CapacityBytes), "CapacityBytes must be a power of two");
+    static_assert(CapacityBytes >= 4 * Align, "CapacityBytes is too small");
+    static_assert(SpillBlockSize % 64 == 0, "SpillBlockSize must be a multiple of 64");
+    static_assert(Align + ((InlineCapture + Align - 1) & ~(Align - 1)) <= CapacityBytes / 2,
+                  "CapacityBytes is too small for InlineCapture");
+
+    struct alignas(Align) Header {
+        detail::callable_ops_t ops; // nullptr marks padding up to the end of the buffer
+        std::uint32_t size;
+    };
+    static_assert(sizeof(Header) == Align);
+
+    struct alignas(64) Block {
+        unsigned char bytes[SpillBlockSize];
+    };
+
+    using free_ring_t = SpscRingBuffer<Block*, SpillBlocks>;
+
+    // In-ring handle to a callable placed in a spill block; destroying it
+    // destroys the callable and hands the block back.
+    template <class Fn>
+    struct Spilled {
+        Fn* fn;
+        Block* block;
+        free_ring_t* free_blocks;
+
+        Spilled(Fn* fn, Block* block, free_ring_t* free_blocks) noexcept
+            : fn(fn), block(block), free_blocks(free_blocks) {}
+        Spilled(Spilled&&) = delete;
+
+        ~Spilled() {
+            std::destroy_at(fn);
+            free_blocks->push(block);
+        }
+
+        void operator()() {
+            (*fn)();
+        }
+    };
+
+    template <class Fn>
+    static constexpr bool fits_inline = sizeof(Fn) <= InlineCapture && alignof(Fn) <= Align;
+
+    static constexpr std::size_t round_up(std::size_t n) noexcept {
+        return (n + Align - 1) & ~(Align - 1);
+    }
+
+public:
+    TaskRing() : arena(std::make_unique<Block[]>(SpillBlocks)) {
+        for (std::size_t i = 0; i < SpillBlocks; ++i) {
+            free_blocks.push(&arena[i]);
+        }
+    }
+
+    TaskRing(const TaskRing&) = delete;
+    TaskRing& operator=(const TaskRing&) = delete;
+
+    // Destroys any callables that were never run.
+    ~TaskRing() {
+        auto t = tail.load(std::memory_order_relaxed);
+        const auto h = head.load(std::memory_order_acquire);
+        while (t != h) {
+            auto* hdr = header_at(t);
+            if (hdr->ops) {
+                hdr->ops(detail::CallableOp::destroy, payload_of(hdr), nullptr);
+            }
+            t += hdr->size;
+        }
+    }
+
+    // Returns false when the ring (or, for large captures, the spill pool) is full;
+    // f is left untouched in that case.
+    template <class F>
+    bool push(F&& f) {
+        using Fn = std::decay_t<F>;
+        static_assert(std::is_invocable_v<Fn&>, "task must be invocable with no arguments");
+        if constexpr (fits_inline<Fn>) {
+            return write(&detail::callable_ops<Fn>, sizeof(Fn), [&](void* p) {
+                std::construct_at(static_cast<Fn*>(p), std::forward<F>(f));
+            });
+        } else {
+            static_assert(sizeof(Fn) <= SpillBlockSize && alignof(Fn) <= alignof(Block),
+                          "capture does not fit a spill block");
+            Block* block = std::exchange(spare, nullptr);
+            if (!block && !free_blocks.pop(block)) {
+                return false;
+            }
+            const bool ok = write(&detail::callable_ops<Spilled<Fn>>, sizeof(Spilled<Fn>), [&](void* p) {
+                auto* fn = std::construct_at(reinterpret_cast<Fn*>(block->bytes), std::forward<F>(f));
+                std::construct_at(static_cast<Spilled<Fn>*>(p), fn, block, &free_blocks);
+            });
+            if (!ok) {
+                spare = block;
+            }
+            return ok;
+        }
+    }
+
+    // Runs the oldest task, if any.
+    bool run_one() noexcept {
+        return run_bulk(1) == 1;
+    }
+
+    // Runs up to max_n tasks and releases their space with a single tail store.
+    std::size_t run_bulk(std::size_t max_n) noexcept {
+        auto t = tail.load(std::memory_order_relaxed);
+        const auto h = head.load(std::memory_order_acquire);
+        std::size_t ran = 0;
+        while (t != h && ran < max_n) {
+            auto* hdr = header_at(t);
+            if (!hdr->ops) {
+                t += hdr->size;
+                continue;
+            }
+            const std::uint32_t size = hdr->size;
+            hdr->ops(detail::CallableOp::consume, payload_of(hdr), nullptr);
+            t += size;
+            ++ran;
+        }
+        tail.store(t, std::memory_order_release);
+        return ran;
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+    }
+
+    static constexpr std::size_t capacity_bytes() noexcept {
+        return CapacityBytes;
+    }
+
+private:
+    Header* header_at(std::size_t pos) noexcept {
+        return reinterpret_cast<Header*>(&storage[pos & Mask]);
+    }
+
+    static void* payload_of(Header* hdr) noexcept {
+        return reinterpret_cast<unsigned char*>(hdr) + sizeof(Header);
+    }
+
+    template <class Construct>
+    bool write(detail::callable_ops_t ops, std::size_t payload_size, Construct&& construct) {
+        const std::size_t need = sizeof(Header) + round_up(payload_size);
+        const auto h = head.load(std::memory_order_relaxed);
+        const std::size_t off = h & Mask;
+        const std::size_t contiguous = CapacityBytes - off;
+        const std::size_t pad = contiguous < need ? contiguous : 0;
+        if (pad + need > CapacityBytes - (h - cached_tail)) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (pad + need > CapacityBytes - (h - cached_tail)) {
+                return false;
+            }
+        }
+        if (pad) {
+            std::construct_at(header_at(h), Header{nullptr, static_cast<std::uint32_t>(pad)});
+        }
+        auto* hdr = std::construct_at(header_at(h + pad), Header{ops, static_cast<std::uint32_t>(need)});
+        construct(payload_of(hdr));
+        head.store(h + pad + need, std::memory_order_release);
+        return true;
+    }
+
+    alignas(64) unsigned char storage[CapacityBytes];
+
+    std::unique_ptr<Block[]> arena;
+    free_ring_t free_blocks;
+
+    alignas(64) std::atomic<std::size_t> head{0};
+    std::size_t cached_tail = 0; // producer-only
+    Block* spare = nullptr;      // producer-only: block taken for a push that did not fit
+
+    alignas(64) std::atomic<std::size_t> tail{0};
+};
+
+}
@@ -0,0 +1,267 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if __has_include(<linux/membarrier.h>)
+#include <linux/membarrier.h>
+#define RB_HAS_MEMBARRIER 1
+#endif
+#endif
+#include "ring_buffer/inline_callable.hpp"
+#include "ring_buffer/ring_buffer.hpp"
+
+// Fixed-size thread pool fed through per-worker SPSC inboxes.
+// Requirements:
+//  - A single submitter thread calls submit()/try_submit(); tasks are spread
+//    round-robin over the worker inboxes.
+//  - Each worker drains its own inbox first and steals from the others when idle.
+//    Consumer access to an inbox is serialized by a per-inbox try-lock, so the
+//    owner's path stays uncontended unless somebody is actually stealing.
+//  - Idle workers spin briefly, then park on an atomic wait (futex on Linux).
+//  - Tasks must not throw, must be nothrow movable and their captures must fit
+//    InlineCapture bytes: they are stored in the inbox slots, never on the heap.
+// The submitter and a parking worker need a store-load fence between them;
+// where membarrier() is available the parking side pays for both with it, so
+// submit() itself issues no fence, and a notify only when somebody is parked.
+
+namespace rb {
+
+// Pins the calling thread to one CPU. Returns false where unsupported or on failure.
+inline bool pin_current_thread(unsigned core) noexcept {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)core;
+    return false;
+#endif
+}
+
+namespace detail {
+
+// Registers the process for expedited membarrier() once; false where unsupported.
+inline bool membarrier_registered() noexcept {
+#if defined(RB_HAS_MEMBARRIER)
+    static const bool ok = syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0;
+    return ok;
+#else
+    return false;
+#endif
+}
+
+}
+
+template <std::size_t InboxCapacityPow2 = 1024, std::size_t InlineCapture = 48>
+class ThreadPool {
+    static_assert(is_power_of_two(InboxCapacityPow2), "InboxCapacityPow2 must be a power of two");
+
+public:
+    using task_t = detail::InlineTask<InlineCapture>;
+
+    struct Options {
+        std::size_t workers = 1;
+        // cores[i] is the CPU worker i is pinned to; missing or negative entries leave it unpinned.
+        std::vector<int> cores{};
+        // Empty polls before a worker parks.
+        unsigned spin_before_park = 4096;
+    };
+
+    explicit ThreadPool(std::size_t workers) : ThreadPool(Options{workers}) {}
+
+    explicit ThreadPool(Options opts)
+        : count(opts.workers ? opts.workers : 1),
+          spin_limit(opts.spin_before_park),
+          asymmetric_fence(detail::membarrier_registered()),
+          workers(std::make_unique<Worker[]>(count)) {
+        try {
+            for (std::size_t i = 0; i < count; ++i) {
+                const int core = i < opts.cores.size() ? opts.cores[i] : -1;
+                workers[i].thread = std::thread([this, i, core] {
+                    if (core >= 0) {
+                        pin_current_thread(static_cast<unsigned>(core));
+                    }
+                    run(i);
+                });
+            }
+        } catch (...) {
+            shutdown(); // joins the workers already started
+            throw;
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Runs every task already submitted, then joins the workers.
+    ~ThreadPool() {
+        shutdown();
+    }
+
+    // Returns false when every inbox is full; f is left untouched in that case.
+    template <class F>
+    bool try_submit(F&& f) {
+        for (std::size_t k = 0; k < count; ++k) {
+            auto& w = workers[next];
+            next = (next + 1 == count) ? 0 : next + 1;
+            if (w.inbox.emplace(std::forward<F>(f))) {
+                wake_one();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <class F>
+    void submit(F&& f) {
+        while (!try_submit(std::forward<F>(f))) {
+            std::this_thread::yield();
+        }
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept {
+        return count;
+    }
+
+private:
+    struct alignas(64) Worker {
+        SpscRingBuffer<task_t, InboxCapacityPow2> inbox;
+        std::atomic_flag consuming;
+        std::thread thread;
+    };
+
+    void shutdown() noexcept {
+        stop.store(true, std::memory_order_release);
+        epoch.fetch_add(1, std::memory_order_release);
+        epoch.notify_all();
+        for (std::size_t i = 0; i < count; ++i) {
+            if (workers[i].thread.joinable()) {
+                workers[i].thread.join();
+            }
+        }
+    }
+
+    // Store(head) -> load(sleepers) must not pass park()'s store(sleepers) ->
+    // load(head). With membarrier() park() forces the fence onto this thread,
+    // so the common case (nobody parked) is one plain load on top of emplace.
+    void wake_one() noexcept {
+        if (asymmetric_fence) {
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        } else {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+        if (sleepers.load(std::memory_order_relaxed) != 0) {
+            epoch.fetch_add(1, std::memory_order_release);
+            epoch.notify_one();
+        }
+    }
+
+    bool try_run_from(Worker& w) {
+        if (w.inbox.empty() || w.consuming.test_and_set(std::memory_order_acquire)) {
+            return false;
+        }
+        auto task = w.inbox.try_pop();
+        w.consuming.clear(std::memory_order_release);
+        if (!task) {
+            return false;
+        }
+        (*task)();
+        return true;
+    }
+
+    bool run_one(std::size_t self) {
+        if (try_run_from(workers[self])) {
+            return true;
+        }
+        for (std::size_t k = 1; k < count; ++k) {
+            const std::size_t victim = (self + k) % count;
+            if (try_run_from(workers[victim])) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    [[nodiscard]] bool has_work() const noexcept {
+        for (std::size_t i = 0; i < count; ++i) {
+            if (!workers[i].inbox.empty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void park() {
+        const auto seen = epoch.load(std::memory_order_acquire);
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        if (!heavy_fence()) {
+            // Submitters rely on the membarrier and fence nothing themselves, so
+            // sleeping now could miss a wakeup: stay awake and retry next idle round.
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+            std::this_thread::yield();
+            return;
+        }
+        if (!has_work() && !stop.load(std::memory_order_acquire)) {
+            epoch.wait(seen, std::memory_order_acquire);
+        }
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Full fence here and, with membarrier(), on every running thread of the
+    // process. False if the membarrier that submitters depend on failed.
+    bool heavy_fence() noexcept {
+        if (!asymmetric_fence) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            return true;
+        }
+#if defined(RB_HAS_MEMBARRIER)
+        return syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0) == 0;
+#else
+        return false;
+#endif
+    }
+
+    void run(std::size_t self) {
+        unsigned idle = 0;
+        while (true) {
+            if (run_one(self)) {
+                idle = 0;
+                continue;
+            }
+            if (stop.load(std::memory_order_acquire)) {
+                if (!has_work()) {
+                    break;
+                }
+                continue;
+            }
+            if (++idle < spin_limit) {
+                cpu_relax();
+                continue;
+            }
+            park();
+            idle = 0;
+        }
+    }
+
+    const std::size_t count;
+    const unsigned spin_limit;
+    const bool asymmetric_fence; // membarrier() registered: submitters skip the fence
+    std::unique_ptr<Worker[]> workers;
+    std::size_t next = 0; // submitter-only
+
+    alignas(64) std::atomic<std::uint32_t> epoch{0};
+    alignas(64) std::atomic<std::uint32_t> sleepers{0};
+    std::atomic<bool> stop{false};
+};
+
+}
@@ -0,0 +1,194 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "ring_buffer/ring_buffer.hpp"
+#include "ring_buffer/tsc.hpp"
+
+// Capture and replay of message traffic for realistic benchmarks.
+// TraceRecorder sits in an instrumented producer and logs every message's
+// arrival (TSC) and size; its Trace holds inter-arrival gaps in nanoseconds.
+// On disk a trace is the magic "RBTRACE1", the event count as a little-endian
+// u64, then per event the gap and the size as LEB128 varints, so bursts of
+// small messages take two or three bytes each. replay() re-issues the events
+// through any callable at their original spacing (optionally sped up),
+// busy-waiting on the TSC between them.
+
+namespace rb {
+
+struct TraceEvent {
+    std::uint64_t gap_ns; // since the previous event; 0 for the first
+    std::uint32_t size;
+};
+
+class Trace {
+    static constexpr char Magic[8] = {'R', 'B', 'T', 'R', 'A', 'C', 'E', '1'};
+
+public:
+    void append(std::uint64_t gap_ns, std::uint32_t size) {
+        events_.push_back(TraceEvent{gap_ns, size});
+        duration += gap_ns;
+    }
+
+    [[nodiscard]] const std::vector<TraceEvent>& events() const noexcept {
+        return events_;
+    }
+    [[nodiscard]] std::size_t size() const noexcept {
+        return events_.size();
+    }
+    // Time from the first to the last event.
+    [[nodiscard]] std::uint64_t duration_ns() const noexcept {
+        return duration;
+    }
+
+    bool save(const char* path) const {
+        std::vector<unsigned char> out(Magic, Magic + sizeof(Magic));
+        put_u64(out, events_.size());
+        for (const auto& e : events_) {
+            put_varint(out, e.gap_ns);
+            put_varint(out, e.size);
+        }
+        std::FILE* f = std::fopen(path, "wb");
+        if (f == nullptr) {
+            return false;
+        }
+        const bool ok = std::fwrite(out.data(), 1, out.size(), f) == out.size();
+        return std::fclose(f) == 0 && ok;
+    }
+
+    // Replaces the contents with the trace in path; false if it is missing or malformed.
+    bool load(const char* path) {
+        std::FILE* f = std::fopen(path, "rb");
+        if (f == nullptr) {
+            return false;
+        }
+        std::vector<unsigned char> in;
+        unsigned char buf[1 << 16];
+        for (std::size_t n; (n = std::fread(buf, 1, sizeof(buf), f)) != 0;) {
+            in.insert(in.end(), buf, buf + n);
+        }
+        std::fclose(f);
+        if (in.size() < sizeof(Magic) + 8 || std::memcmp(in.data(), Magic, sizeof(Magic)) != 0) {
+            return false;
+        }
+        std::size_t pos = sizeof(Magic);
+        std::uint64_t count = 0;
+        for (unsigned i = 0; i < 8; ++i) {
+            count |= std::uint64_t{in[pos++]} << (8 * i);
+        }
+        Trace t;
+        t.events_.reserve(count < in.size() ? count : in.size());
+        for (std::uint64_t i = 0; i < count; ++i) {
+            std::uint64_t gap = 0, size = 0;
+            if (!get_varint(in, pos, gap) || !get_varint(in, pos, size) || size > 0xFFFFFFFFu) {
+                return false;
+            }
+            t.append(gap, static_cast<std::uint32_t>(size));
+        }
+        *this = std::move(t);
+        return true;
+    }
+
+private:
+    static void put_u64(std::vector<unsigned char>& out, std::uint64_t v) {
+        for (unsigned i = 0; i < 8; ++i) {
+            out.push_back(static_cast<unsigned char>(v >> (8 * i)));
+        }
+    }
+
+    static void put_varint(std::vector<unsigned char>& out, std::uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back(static_cast<unsigned char>(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<unsigned char>(v));
+    }
+
+    static bool get_varint(const std::vector<unsigned char>& in, std::size_t& pos, std::uint64_t& v) {
+        v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (pos >= in.size()) {
+                return false;
+            }
+            const unsigned char b = in[pos++];
+            v |= std::uint64_t{b & 0x7Fu} << shift;
+            if ((b & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<TraceEvent> events_;
+    std::uint64_t duration = 0;
+};
+
+// Producer-side instrumentation: one TSC read and one vector append per message.
+class TraceRecorder {
+    struct Raw {
+        std::uint64_t tsc;
+        std::uint32_t size;
+    };
+
+public:
+    explicit TraceRecorder(std::size_t expected_events = 1 << 20) {
+        raw.reserve(expected_events);
+    }
+
+    void record(std::uint32_t size) {
+        raw.push_back(Raw{read_tsc(), size});
+    }
+
+    // Converts what was recorded so far into inter-arrival gaps.
+    [[nodiscard]] Trace trace() const {
+        Trace t;
+        const double per_ns = tsc_ticks_per_ns();
+        for (std::size_t i = 0; i < raw.size(); ++i) {
+            const std::uint64_t ticks = i ? raw[i].tsc - raw[i - 1].tsc : 0;
+            t.append(static_cast<std::uint64_t>(static_cast<double>(ticks) / per_ns), raw[i].size);
+        }
+        return t;
+    }
+
+private:
+    std::vector<Raw> raw;
+};
+
+struct ReplayStats {
+    std::uint64_t events = 0;
+    std::uint64_t late = 0;        // events issued more than late_after_ns past due
+    std::uint64_t max_late_ns = 0; // worst lateness, e.g. from a slow emit or a full ring
+};
+
+// Calls emit(event) for every event of trace at its original spacing divided
+// by speed, spinning on the TSC until each one is due. Lateness accumulates:
+// a stalled emit is not caught up by skipping gaps.
+template <class Emit>
+ReplayStats replay(const Trace& trace, Emit&& emit, double speed = 1.0, std::uint64_t late_after_ns = 1000) {
+    ReplayStats stats;
+    const double ticks_per_ns = tsc_ticks_per_ns() / (speed > 0 ? speed : 1.0);
+    const auto late_ticks = static_cast<std::uint64_t>(static_cast<double>(late_after_ns) * tsc_ticks_per_ns());
+    const std::uint64_t start = read_tsc();
+    double due_offset = 0;
+    for (const TraceEvent& e : trace.events()) {
+        due_offset += static_cast<double>(e.gap_ns) * ticks_per_ns;
+        const std::uint64_t due = start + static_cast<std::uint64_t>(due_offset);
+        std::uint64_t now = read_tsc();
+        while (now < due) {
+            cpu_relax();
+            now = read_tsc();
+        }
+        if (now - due > late_ticks) {
+            ++stats.late;
+            const auto late_ns = static_cast<std::uint64_t>(tsc_to_ns(now - due));
+            stats.max_late_ns = late_ns > stats.max_late_ns ? late_ns : stats.max_late_ns;
+        }
+        emit(e);
+        ++stats.events;
+    }
+    return stats;
+}
+
+}
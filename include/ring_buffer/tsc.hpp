@@ -0,0 +1,46 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+// Cheap timestamps for hot-path instrumentation.
+// read_tsc() is the raw time-stamp counter on x86 and steady_clock nanoseconds
+// elsewhere; tsc_ticks_per_ns() converts between the two (calibrated once).
+
+namespace rb {
+
+inline std::uint64_t read_tsc() noexcept {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Ticks of read_tsc() per nanosecond. The first call blocks for ~10 ms to calibrate.
+inline double tsc_ticks_per_ns() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    static const double ratio = [] {
+        const auto c0 = std::chrono::steady_clock::now();
+        const auto t0 = read_tsc();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        const auto t1 = read_tsc();
+        const auto c1 = std::chrono::steady_clock::now();
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(c1 - c0).count();
+        return (double)(t1 - t0) / (double)(ns ? ns : 1);
+    }();
+    return ratio;
+#else
+    return 1.0;
+#endif
+}
+
+inline double tsc_to_ns(std::uint64_t ticks) {
+    return (double)ticks / tsc_ticks_per_ns();
+}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <chrono>
+#include <thread>
+
+// Idle strategies for a thread polling a ring.
+// A strategy is a small value type: operator() performs one idle step after an
+// empty poll and may escalate across calls; reset() returns it to its cheapest
+// step once work shows up again.
+//  - SpinWait:    pause instruction only; lowest latency, burns the core.
+//  - YieldWait:   std::this_thread::yield(); cedes the core to other runnable threads.
+//  - BackoffWait: spins, then yields, then sleeps for short, growing intervals.
+
+namespace rb {
+
+// Spin-loop hint: lets the sibling hyper-thread run and saves power while busy-waiting.
+inline void cpu_relax() noexcept {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_ia32_pause();
+#elif defined(__GNUC__) && defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+struct SpinWait {
+    void operator()() noexcept {
+        cpu_relax();
+    }
+    void reset() noexcept {}
+};
+
+struct YieldWait {
+    void operator()() noexcept {
+        std::this_thread::yield();
+    }
+    void reset() noexcept {}
+};
+
+struct BackoffWait {
+    unsigned spins = 1024;  // pause steps before yielding
+    unsigned yields = 64;   // yield steps before sleeping
+    std::chrono::microseconds max_sleep{100};
+
+    void operator()() {
+        if (step < spins) {
+            cpu_relax();
+        } else if (step < spins + yields) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(sleep);
+            sleep = sleep * 2 < max_sleep ? sleep * 2 : max_sleep;
+            return;
+        }
+        ++step;
+    }
+    void reset() noexcept {
+        step = 0;
+        sleep = std::chrono::microseconds{1};
+    }
+
+private:
+    unsigned step = 0;
+    std::chrono::microseconds sleep{1};
+};
+
+}
@@ -1,6 +1,35 @@
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
 #include "ring_buffer/ring_buffer.hpp"
+#include "ring_buffer/thread_pool.hpp"
+#include "ring_buffer/priority_channel.hpp"
+#include "ring_buffer/task_ring.hpp"
+#include "ring_buffer/message_ring.hpp"
+#include "ring_buffer/pooled_channel.hpp"
+#include "ring_buffer/numa.hpp"
+#include "ring_buffer/residence.hpp"
+#include "ring_buffer/conflating_channel.hpp"
+#include "ring_buffer/compact_ring_buffer.hpp"
+#include "ring_buffer/soa_ring_buffer.hpp"
+#include "ring_buffer/stages.hpp"
+#include "ring_buffer/batching_producer.hpp"
+#include "ring_buffer/partitioned_channel.hpp"
+#include "ring_buffer/merge_consumer.hpp"
+#include "ring_buffer/feed_arbiter.hpp"
+#include "ring_buffer/async_logger.hpp"
+#include "ring_buffer/file_sink.hpp"
+#include "ring_buffer/file_source.hpp"
+#include "ring_buffer/traffic_trace.hpp"
 
 int main() {
     {
@@ -8,14 +37,15 @@ int main() {
         assert(q.empty());
         assert(!q.full());
 
-        for (int i = 0; i < 7; ++i) {
+        for (int i = 0; i < 8; ++i) {
             bool ok = q.emplace(i);
             assert(ok);
         }
         assert(q.full());
+        assert(!q.emplace(8));
 
         int v = -1;
-        for (int i = 0; i < 7; ++i) {
+        for (int i = 0; i < 8; ++i) {
             bool ok = q.pop(v);
             assert(ok && v == i);
         }
@@ -34,9 +64,11 @@ int main() {
     {
         rb::SpscRingBuffer<int, 2> q;
         assert(q.emplace(42));
-        assert(!q.emplace(7));
+        assert(q.emplace(7));
+        assert(!q.emplace(8));
         int v;
         assert(q.pop(v) && v == 42);
+        assert(q.pop(v) && v == 7);
         assert(!q.pop(v));
     }
 
@@ -68,5 +100,845 @@ int main() {
         int v[3] {1,2,3};
         assert(q.emplace_bulk(v, v+3));
     }
+
+    {
+        rb::SpscRingBuffer<int, 5> q;
+        int in[5] {0, 1, 2, 3, 4};
+        int out[5] {};
+        for (int lap = 0; lap < 4; ++lap) {
+            assert(q.emplace_bulk(in, in + 3) == 3);
+            assert(q.push(lap) && q.push(lap));
+            assert(q.full() && !q.push(9));
+            assert(q.pop_bulk(out, 2) == 2 && out[0] == 0 && out[1] == 1);
+            assert(q.peek(out[0]) && out[0] == 2);
+            assert(q.pop_bulk(out, 5) == 3 && out[0] == 2 && out[2] == lap);
+            assert(q.empty());
+        }
+    }
+
+    {
+        std::atomic<int> sum{0};
+        {
+            rb::ThreadPool<16> pool(2);
+            for (int i = 1; i <= 1000; ++i) {
+                pool.submit([&sum, i] { sum.fetch_add(i, std::memory_order_relaxed); });
+            }
+        }
+        assert(sum.load() == 1000 * 1001 / 2);
+
+        // One worker blocks until every other task has run, so the tasks queued
+        // in its own inbox can only finish by being stolen.
+        std::atomic<int> done{0};
+        std::atomic<std::thread::id> blocked{};
+        std::atomic<bool> ran_on_blocked{false};
+        {
+            rb::ThreadPool<64> pool(rb::ThreadPool<64>::Options{2, {}, 16});
+            pool.submit([&] {
+                blocked.store(std::this_thread::get_id());
+                const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+                while (done.load() < 40 && std::chrono::steady_clock::now() < deadline) {
+                    std::this_thread::yield();
+                }
+            });
+            while (blocked.load() == std::thread::id{}) {
+                std::this_thread::yield();
+            }
+            for (int i = 0; i < 40; ++i) {
+                pool.submit([&] {
+                    ran_on_blocked.store(ran_on_blocked.load() || std::this_thread::get_id() == blocked.load());
+                    done.fetch_add(1);
+                });
+            }
+        }
+        assert(done.load() == 40 && !ran_on_blocked.load());
+    }
+
+    {
+        rb::PriorityChannel<int, 4, 16> ch;
+        assert(ch.empty());
+        for (int i = 0; i < 5; ++i) {
+            assert(ch.push(1, 100 + i));
+        }
+        assert(ch.emplace<0>(1));
+        assert(ch.emplace<0>(2));
+        int v[8];
+        assert(ch.pop_bulk(v, 3) == 3 && v[0] == 1 && v[1] == 2 && v[2] == 100);
+        assert(ch.push(0, 3));
+        assert(ch.pop(v[0]) && v[0] == 3);
+
+        ch.set_weights({1, 2});
+        assert(ch.push(0, 4) && ch.push(0, 5));
+        assert(ch.pop_bulk(v, 8, rb::DrainPolicy::weighted) == 6);
+        assert(v[0] == 4 && v[1] == 101 && v[2] == 102 && v[3] == 5 && v[4] == 103 && v[5] == 104);
+        assert(ch.empty());
+
+        // One item per call: the round continues across calls instead of restarting at lane 0.
+        rb::PriorityChannel<int, 8, 8, 8> three;
+        three.set_weights({1, 2, 3});
+        for (int i = 0; i < 8; ++i) {
+            assert(three.push(0, i) && three.push(1, 100 + i) && three.push(2, 200 + i));
+        }
+        int share[3] = {};
+        for (int i = 0; i < 12; ++i) {
+            assert(three.pop_bulk(v, 1, rb::DrainPolicy::weighted) == 1);
+            ++share[v[0] / 100];
+        }
+        assert(share[0] == 2 && share[1] == 4 && share[2] == 6);
+    }
+
+    {
+        rb::TaskRing<256, 32, 2, 128> tasks;
+        int small = 0;
+        std::array<int, 20> big{};
+        big[19] = 5;
+        int sum = 0;
+        assert(tasks.push([&small] { ++small; }));
+        assert(tasks.push([&sum, big] { sum += big[19]; }));
+        assert(tasks.push([&sum, big] { sum += big[19]; }));
+        assert(!tasks.push([&sum, big] { sum += big[19]; })); // spill pool exhausted
+        assert(tasks.run_bulk(8) == 3);
+        assert(small == 1 && sum == 10 && tasks.empty());
+
+        for (int i = 0; i < 100; ++i) { // wraps the byte ring many times
+            assert(tasks.push([&small, i] { small += i; }));
+            assert(tasks.push([&sum, big] { sum += big[19]; }));
+            assert(tasks.run_bulk(8) == 2);
+        }
+        assert(small == 1 + 99 * 100 / 2 && sum == 510);
+
+        auto owned = std::make_shared<int>(1);
+        assert(tasks.push([owned] {}));
+        assert(owned.use_count() == 2);
+        assert(tasks.run_one());
+        assert(owned.use_count() == 1);
+    }
+
+    {
+        struct OrderAck { std::uint64_t id; };
+        struct Note { std::string text; };
+        struct alignas(32) Wide { double v[4]; };
+        rb::MessageRing<256, OrderAck, Note, Wide> ring;
+        static_assert(decltype(ring)::tag_of<Note> == 1);
+
+        std::uint64_t ids = 0;
+        std::string notes;
+        double wide = 0;
+        auto visitor = [&](auto& m) {
+            using M = std::decay_t<decltype(m)>;
+            if constexpr (std::is_same_v<M, OrderAck>) {
+                ids += m.id;
+            } else if constexpr (std::is_same_v<M, Note>) {
+                notes += m.text;
+            } else {
+                assert(reinterpret_cast<std::uintptr_t>(&m) % 32 == 0);
+                wide += m.v[3];
+            }
+        };
+        for (int round = 0; round < 50; ++round) { // wraps the byte ring many times
+            assert(ring.push<OrderAck>(OrderAck{7}));
+            assert(ring.push<Note>(Note{"x"}));
+            assert(ring.push<Wide>(Wide{{0, 0, 0, 1.5}}));
+            assert(ring.consume(visitor, 2) == 2);
+            assert(ring.consume(visitor) == 1);
+        }
+        assert(ids == 350 && notes.size() == 50 && wide == 75.0 && ring.empty());
+
+        while (ring.push<OrderAck>(OrderAck{1})) {
+        }
+        assert(ring.size_bytes() > 256 - 16);
+    }
+
+    {
+        using channel_t = rb::PooledChannel<4096, 4, 2>;
+        channel_t ch;
+        channel_t::Buffer* held[4];
+        for (auto& b : held) {
+            b = ch.acquire();
+            assert(b != nullptr);
+        }
+        assert(ch.acquire() == nullptr);
+        for (std::size_t i = 0; i < 4; ++i) {
+            held[i]->data[0] = static_cast<unsigned char>(i);
+            assert(ch.send(held[i], i + 1));
+        }
+        for (std::size_t i = 0; i < 3; ++i) {
+            auto* b = ch.receive();
+            assert(b == held[i] && b->size == i + 1 && b->data[0] == i);
+            ch.release(b);
+        }
+        assert(ch.acquire() == held[1]); // most recently returned first
+        assert(ch.acquire() == held[0]);
+        assert(ch.acquire() == nullptr);  // held[2] still waits in the partial batch
+        ch.flush_returns();
+        assert(ch.acquire() == held[2]);
+        assert(ch.receive() == held[3] && ch.receive() == nullptr);
+    }
+
+    {
+        assert((rb::numa::parse_cpu_list("0-2,5\n") == std::vector<int>{0, 1, 2, 5}));
+        const auto topo = rb::numa::Topology::detect();
+        assert(!topo.nodes.empty() && topo.cpus.size() == topo.nodes.size());
+
+        using ring_t = rb::SpscRingBuffer<int, 1024>;
+        for (const auto where : {rb::numa::Placement{}, rb::numa::Placement::on_node(topo.nodes[0]),
+                                 rb::numa::Placement::interleaved()}) {
+            auto q = rb::numa::make_ring<ring_t>(where);
+            assert(q);
+            assert(q->push(3));
+            int v = 0;
+            assert(q->pop(v) && v == 3);
+        }
+
+        auto raw = rb::numa::make_ring<ring_t>(rb::numa::Placement{}, rb::no_zero_init);
+        assert(raw && raw->empty());
+        raw->prefault();
+        (void)raw->lock_memory(); // may be refused by RLIMIT_MEMLOCK
+        assert(raw->push(4));
+        int v = 0;
+        assert(raw->pop(v) && v == 4);
+
+        struct Throwing {
+            explicit Throwing(int e) { throw e; }
+        };
+        int caught = 0;
+        try {
+            (void)rb::numa::make_ring<Throwing>(rb::numa::Placement{}, 7);
+        } catch (int e) {
+            caught = e; // the mapping was released before the rethrow
+        }
+        assert(caught == 7);
+    }
+
+    {
+        for (std::uint64_t x : {0ull, 7ull, 8ull, 9ull, 1000ull, 123456789ull, ~0ull}) {
+            const auto b = rb::LatencyHistogram::bucket_of(x);
+            assert(b < rb::LatencyHistogram::bucket_count);
+            assert(rb::LatencyHistogram::lower_bound(b) <= x);
+            assert(b + 1 == rb::LatencyHistogram::bucket_count || rb::LatencyHistogram::lower_bound(b + 1) > x);
+        }
+
+        rb::TimedSpscRingBuffer<int, 8> every;
+        for (int i = 0; i < 8; ++i) {
+            assert(every.push(i));
+        }
+        assert(!every.push(8));
+        int v = -1;
+        assert(every.pop(v) && v == 0);
+        assert(every.try_pop().value() == 1);
+        int rest[8];
+        assert(every.pop_bulk(rest, 8) == 6 && rest[5] == 7);
+        assert(every.histogram().count() == 8);
+
+        rb::TimedSpscRingBuffer<int, 16> sampled(4);
+        for (int i = 0; i < 10; ++i) {
+            assert(sampled.push(i));
+        }
+        assert(sampled.pop(v) && v == 0);
+        assert(sampled.pop_bulk(rest, 8) == 8 && rest[7] == 8);
+        assert(sampled.pop(v) && v == 9);
+        assert(sampled.histogram().count() == 3); // messages 0, 4 and 8
+        assert(sampled.histogram().percentile(1.0) <= sampled.histogram().max());
+    }
+
+    {
+        rb::SpscRingBuffer<int, 16> q;
+        int transitions[2] = {0, 0};
+        q.set_watermarks(8, 4, [](void* ctx, bool congested) noexcept {
+            static_cast<int*>(ctx)[congested ? 1 : 0]++;
+        }, transitions);
+        for (int i = 0; i < 7; ++i) {
+            assert(q.push(i));
+        }
+        assert(!q.congested());
+        assert(q.push(7));
+        assert(q.congested() && transitions[1] == 1);
+        int v[4];
+        assert(q.pop_bulk(v, 3) == 3);
+        assert(q.poll_watermarks() && transitions[0] == 0); // depth 5 > low
+        assert(q.pop(v[0]));
+        assert(!q.poll_watermarks() && transitions[0] == 1);
+        assert(q.emplace_bulk(v, v + 4) == 4);
+        assert(q.congested() && transitions[1] == 2);
+    }
+
+    {
+        struct Quote { double bid; double ask; std::uint32_t size; };
+        rb::ConflatingChannel<Quote, 8> ch;
+        assert(!ch.publish(8, Quote{}));
+        for (int i = 0; i < 100; ++i) {
+            assert(ch.publish(3, Quote{100.0 + i, 101.0 + i, 10}));
+        }
+        assert(ch.publish(5, Quote{1, 2, 3}));
+        assert(ch.publish(3, Quote{7, 8, 9}));
+        assert(ch.pending() == 2);
+
+        std::uint32_t key;
+        Quote q{};
+        assert(ch.pop(key, q) && key == 3 && q.bid == 7 && q.size == 9);
+        assert(ch.publish(3, Quote{11, 12, 13})); // re-queued after being consumed
+        std::size_t seen = ch.consume([&](std::uint32_t k, const Quote& v) {
+            assert((k == 5 && v.size == 3) || (k == 3 && v.size == 13));
+        });
+        assert(seen == 2 && ch.empty());
+        assert(ch.load(3, q) && q.ask == 12);
+    }
+
+    {
+        rb::CompactSpscRingBuffer<std::uint32_t, 4, std::uint16_t> q;
+        static_assert(sizeof(q) == 2 * sizeof(std::uint16_t) + 4 * sizeof(std::uint32_t));
+        std::uint32_t expect = 0;
+        std::uint32_t out[4];
+        for (std::uint32_t i = 0; i < 70'000; i += 3) { // wraps the 16-bit counters
+            assert(q.push(i) && q.push(i + 1) && q.push(i + 2));
+            assert(q.size() == 3 && !q.full());
+            assert(q.pop(out[0]) && out[0] == expect++);
+            assert(q.pop_bulk(out, 4) == 2 && out[0] == expect && out[1] == expect + 1);
+            expect += 2;
+            assert(q.empty());
+        }
+        for (std::uint32_t i = 0; i < 4; ++i) {
+            assert(q.push(i));
+        }
+        assert(q.full() && !q.push(4));
+
+        rb::CompactSpscRingBuffer<std::string, 2, std::uint8_t, 64> padded;
+        static_assert(sizeof(padded) >= 128);
+        assert(padded.push("a") && padded.try_pop().value() == "a");
+    }
+
+    {
+        rb::SoaRingBuffer<8, std::uint32_t, double, std::uint32_t, std::uint64_t> ticks;
+        for (std::uint32_t i = 0; i < 6; ++i) {
+            assert(ticks.push(i, 1.5 * i, 10 * i, 1000 + i));
+        }
+        auto view = ticks.read_spans();
+        assert(view.size() == 6 && view.column_second<1>().empty());
+        double notional = 0;
+        for (double px : view.column_first<1>()) {
+            notional += px;
+        }
+        assert(notional == 1.5 * 15);
+        ticks.release(4);
+
+        for (std::uint32_t i = 6; i < 12; ++i) {
+            assert(ticks.push(i, 1.5 * i, 10 * i, 1000 + i));
+        }
+        assert(!ticks.push(0, 0, 0, 0));
+        view = ticks.read_spans(7);
+        assert(view.size() == 7 && view.column_first<0>().size() == 4 && view.column_second<0>().size() == 3);
+        assert(view.column_first<0>()[0] == 4 && view.column_second<3>()[2] == 1010);
+        ticks.release(7);
+
+        std::uint32_t sym, qty;
+        double px;
+        std::uint64_t ts;
+        assert(ticks.pop(sym, px, qty, ts) && sym == 11 && qty == 110 && ts == 1011);
+        assert(ticks.empty());
+    }
+
+    {
+        rb::SpscRingBuffer<std::uint32_t, 64> src;
+        rb::SpscRingBuffer<std::uint32_t, 24> dst;
+        auto spans = dst.reserve(3);
+        assert(spans.size() == 3);
+        spans.first[0] = 7;
+        dst.commit(1);
+        std::uint32_t v = 0;
+        assert(dst.pop(v) && v == 7);
+
+        for (std::uint32_t i = 0; i < 40; ++i) { // src run wraps after the pop below
+            assert(src.push(i));
+        }
+        std::uint32_t skip[30];
+        assert(src.pop_bulk(skip, 30) == 30);
+        for (std::uint32_t i = 40; i < 94; ++i) {
+            assert(src.push(i));
+        }
+        assert(src.full());
+        auto even = [](std::uint32_t x) { return x % 2 == 0; };
+        auto r = rb::filter_into(src, dst, even);
+        assert(r.produced == 24 && r.consumed == 48); // dst full at 76; 78 onwards stays in src
+        std::uint32_t expect = 30;
+        while (dst.pop(v)) {
+            assert(v == expect);
+            expect += 2;
+        }
+        r = rb::filter_into(src, dst, even);
+        assert(r.consumed == 16 && r.produced == 8 && src.empty());
+
+        r = rb::transform_into(dst, src, [](std::uint32_t x) { return x + 1; });
+        assert(r.consumed == 8 && src.pop(v) && v == 79);
+    }
+
+    {
+        struct Big { std::uint64_t words[40]; };
+        rb::SpscRingBuffer<Big, 4, rb::StorePolicy::streaming> streamed;
+        rb::SpscRingBuffer<Big, 4, rb::StorePolicy::demote> demoted;
+        Big b{};
+        for (std::uint64_t i = 0; i < 40; ++i) {
+            b.words[i] = i * 3;
+        }
+        for (int lap = 0; lap < 3; ++lap) {
+            assert(streamed.push(b) && streamed.emplace(b) && demoted.push(b));
+            assert(streamed.emplace_bulk(&b, &b + 1) == 1);
+            Big out{};
+            assert(streamed.pop(out) && out.words[39] == 117 && out.words[1] == 3);
+            assert(streamed.pop(out) && streamed.pop(out) && out.words[20] == 60);
+            assert(demoted.pop(out) && out.words[7] == 21);
+        }
+    }
+
+    {
+        rb::SpscRingBuffer<std::uint64_t, 100> q;
+        q.set_prefetch_distance(1'000'000); // clamped to the ring
+        std::uint64_t next = 0, expect = 0;
+        std::uint64_t out[64];
+        for (int round = 0; round < 50; ++round) {
+            while (q.push(next)) {
+                ++next;
+            }
+            const std::size_t n = q.pop_bulk(out, 37);
+            for (std::size_t i = 0; i < n; ++i) {
+                assert(out[i] == expect++);
+            }
+            q.set_prefetch_distance(static_cast<std::size_t>(round % 4));
+            auto spans = q.read_spans(20);
+            assert(spans.size() == 20 && spans.first[0] == expect);
+        }
+    }
+
+    {
+        rb::SpscRingBuffer<int, 6> q;
+        assert(q.stage(1) && q.stage(2) && q.stage(3));
+        assert(q.empty() && q.staged() == 3 && q.producer_depth() == 3);
+        q.publish();
+        assert(q.size() == 3 && q.staged() == 0);
+        assert(q.stage(4) && q.push(5) && q.size() == 5); // push publishes staged elements too
+
+        rb::SpscRingBuffer<int, 8> r;
+        {
+            rb::BatchingProducer bp(r, 8, std::chrono::hours(1));
+            for (int i = 0; i < 7; ++i) {
+                assert(bp.push(i) && r.size() == static_cast<std::size_t>(i) + 1 && bp.batch_size() == 1);
+            }
+            // Cached view full: the tail reload shows the consumer behind, so the batch doubles.
+            assert(bp.push(7) && r.size() == 8 && bp.batch_size() == 2);
+            assert(!bp.push(8));
+            int v;
+            for (int i = 0; i < 8; ++i) {
+                assert(r.pop(v) && v == i);
+            }
+            assert(bp.push(8) && bp.staged() == 1 && r.empty() && !bp.poll());
+            bp.flush();
+            assert(r.size() == 1 && bp.staged() == 0 && bp.batch_size() == 2);
+            assert(r.pop(v) && v == 8);
+            for (int i = 9; i < 15; i += 2) {
+                assert(bp.push(i) && bp.staged() == 1 && bp.push(i + 1) && r.size() == 2);
+                assert(r.pop(v) && r.pop(v) && v == i + 1);
+            }
+            assert(bp.batch_size() == 1); // reloaded once the cached view filled; consumer had drained: halves
+        }
+
+        rb::SpscRingBuffer<int, 2> tiny;
+        {
+            rb::BatchingProducer bp(tiny, 8, std::chrono::hours(1));
+            assert(bp.push(0) && bp.push(1) && bp.batch_size() == 2);
+            int v;
+            assert(tiny.pop(v) && tiny.pop(v) && bp.push(2) && bp.staged() == 1);
+        }
+        assert(tiny.size() == 1); // destructor flushes
+
+        rb::SpscRingBuffer<int, 4> small;
+        rb::BatchingProducer overdue(small, 16, std::chrono::nanoseconds(0));
+        assert(overdue.push(0) && overdue.push(1) && overdue.push(2) && overdue.push(3));
+        assert(!overdue.push(4) && small.size() == 4 && overdue.staged() == 0);
+        int v;
+        assert(small.pop(v) && v == 0 && overdue.push(4));
+        assert(overdue.staged() == 1 && overdue.poll() && small.size() == 4); // zero deadline: overdue at once
+    }
+
+    {
+        rb::SpscRingBuffer<int, 16> q;
+        int out[16];
+        for (int i = 0; i < 3; ++i) {
+            assert(q.push(i));
+        }
+        const auto t0 = std::chrono::steady_clock::now();
+        assert(q.pop_bulk_wait(out, 2, 16, t0 + std::chrono::hours(1)) == 3); // enough already
+        assert(q.push(3));
+        assert(q.pop_bulk_wait(out, 4, 16, t0 + std::chrono::milliseconds(2), rb::SpinWait{}) == 1);
+        assert(out[0] == 3 && std::chrono::steady_clock::now() - t0 >= std::chrono::milliseconds(2));
+        assert(q.pop_bulk_wait(out, 4, 16, t0) == 0);
+
+        std::thread prod([&] {
+            for (int i = 0; i < 12; ++i) {
+                while (!q.push(i)) {
+                }
+                std::this_thread::yield();
+            }
+        });
+        const std::size_t n = q.pop_bulk_wait(out, 12, 12, std::chrono::steady_clock::now() + std::chrono::seconds(30),
+                                              rb::YieldWait{});
+        prod.join();
+        assert(n == 12 && out[11] == 11);
+        for (int i = 0; i < 12; ++i) {
+            assert(q.push(i));
+        }
+        assert(q.pop_bulk_wait(out, 100, 5, t0) == 5 && out[4] == 4); // min_n clamped to max_n
+    }
+
+    {
+        struct Order { std::uint32_t instrument; std::uint32_t seq; };
+        auto by_instrument = [](const Order& o) { return o.instrument; };
+        rb::PartitionedChannel<Order, 3, decltype(by_instrument), 8> ch(by_instrument);
+        std::vector<Order> batch;
+        std::uint32_t seq_of[16] = {};
+        for (std::uint32_t i = 0; i < 12; ++i) {
+            batch.push_back({i % 5, seq_of[i % 5]++});
+        }
+        assert(ch.push_bulk(batch.begin(), batch.end()) == 12);
+        assert(ch.emplace(Order{4, seq_of[4]++}));
+        std::size_t total = 0;
+        std::uint32_t next_seq[16] = {};
+        for (std::size_t p = 0; p < ch.partitions(); ++p) {
+            Order o;
+            while (ch.partition(p).pop(o)) {
+                assert(ch.partition_of(o) == p && o.seq == next_seq[o.instrument]++); // per-key order kept
+                ++total;
+            }
+        }
+        assert(total == 13);
+
+        // A partition filling up stops the batch at the first item that does not fit.
+        batch.clear();
+        for (std::uint32_t i = 0; i < 10; ++i) {
+            batch.push_back({7, i});
+        }
+        const auto p7 = ch.partition_of(batch[0]);
+        assert(ch.push_bulk(batch.begin(), batch.end()) == 8 && ch.partition(p7).full());
+        assert(!ch.push(batch[8]));
+    }
+
+    {
+        struct Tick { std::uint64_t ts; int line; };
+        using line_t = rb::SpscRingBuffer<Tick, 64>;
+        auto by_ts = [](const Tick& t) { return t.ts; };
+        line_t a, b, c;
+        rb::MergeConsumer<line_t, 3, decltype(by_ts), 4> merge({&a, &b, &c}, std::chrono::hours(1), by_ts);
+        for (std::uint64_t ts = 0; ts < 30; ++ts) {
+            line_t& line = ts % 3 == 0 ? a : (ts % 5 == 0 ? b : c);
+            assert(line.push(Tick{ts, 0}));
+        }
+        assert(a.push(Tick{33, 0}) && b.push(Tick{30, 1}) && c.push(Tick{30, 2}));
+        Tick t;
+        for (std::uint64_t ts = 0; ts < 30; ++ts) {
+            assert(merge.pop(t) && t.ts == ts);
+        }
+        assert(merge.peek() && merge.peek()->ts == 30 && merge.peek()->line == 1); // ties go to the lower input
+        assert(merge.pop(t) && t.line == 1);
+        // b is drained and within its hold-back, so c's 30 is not decided yet.
+        assert(!merge.pop(t) && b.push(Tick{40, 1}));
+        assert(merge.pop(t) && t.line == 2 && !merge.peek());
+        assert(c.push(Tick{50, 2}) && a.push(Tick{45, 0}));
+        std::uint64_t seen[2] = {};
+        assert(merge.consume([&](const Tick& x) { seen[seen[0] ? 1 : 0] = x.ts; }, 2) == 2);
+        assert(seen[0] == 33 && seen[1] == 40 && merge.buffered() == 2 && !merge.pop(t)); // b drained again
+
+        // With no hold-back quiet inputs are skipped right away.
+        line_t d, e;
+        rb::MergeConsumer<line_t, 2, decltype(by_ts)> eager({&d, &e}, std::chrono::nanoseconds(0), by_ts);
+        assert(e.push(Tick{7, 1}) && eager.pop(t) && t.ts == 7 && !eager.pop(t));
+    }
+
+    {
+        struct Packet { std::uint64_t seq; char line; };
+        using feed_t = rb::SpscRingBuffer<Packet, 8>;
+        auto seq_of = [](const Packet& p) { return p.seq; };
+        struct Gaps {
+            std::uint64_t first = 0, count = 0;
+            static void record(void* ctx, std::uint64_t first, std::uint64_t count) noexcept {
+                static_cast<Gaps*>(ctx)->first = first;
+                static_cast<Gaps*>(ctx)->count += count;
+            }
+        } gaps;
+        feed_t a, b;
+        rb::FeedArbiter<feed_t, decltype(seq_of)> arb(a, b, std::chrono::hours(1), seq_of);
+        arb.set_gap_callback(&Gaps::record, &gaps);
+        for (std::uint64_t s : {100u, 101u, 102u, 104u, 105u}) {
+            assert(a.push(Packet{s, 'A'}));
+        }
+        for (std::uint64_t s : {100u, 101u, 103u, 104u}) {
+            assert(b.push(Packet{s, 'B'}));
+        }
+        std::uint64_t expect = 100;
+        Packet p;
+        while (arb.pop(p)) {
+            assert(p.seq == expect++);
+        }
+        assert(expect == 106 && arb.duplicates() == 3 && arb.won_by(0) + arb.won_by(1) == 6);
+
+        // 106 missing on both lines: held back, then filled late by B.
+        assert(a.push(Packet{107, 'A'}) && !arb.pop(p) && arb.next_sequence() == 106);
+        assert(b.push(Packet{106, 'B'}) && arb.pop(p) && p.seq == 106 && p.line == 'B');
+        assert(arb.pop(p) && p.seq == 107 && !arb.pop(p));
+
+        // A message a full window ahead gives up everything missing before it without waiting.
+        assert(a.push(Packet{109, 'A'}) && a.push(Packet{120, 'A'}));
+        assert(arb.pop(p) && p.seq == 109 && arb.pop(p) && p.seq == 120);
+        assert(arb.lost() == 11 && gaps.first == 110 && gaps.count == 11 && !arb.pop(p));
+
+        // Without hold-back a gap is reported as soon as both lines are empty.
+        feed_t c, d;
+        rb::FeedArbiter<feed_t, decltype(seq_of), 64> eager(c, d, std::chrono::nanoseconds(0), seq_of);
+        assert(c.push(Packet{1, 'A'}) && d.push(Packet{3, 'B'}) && c.push(Packet{3, 'A'}));
+        assert(eager.pop(p) && p.seq == 1 && eager.pop(p) && p.seq == 3 && p.line == 'B');
+        assert(eager.lost() == 1 && eager.duplicates() == 1);
+
+        // A starts at 105: the arbiter waits for B and starts from B's lower 100.
+        feed_t e, f;
+        rb::FeedArbiter<feed_t, decltype(seq_of), 64> late(e, f, std::chrono::hours(1), seq_of);
+        assert(e.push(Packet{105, 'A'}) && e.push(Packet{106, 'A'}) && !late.pop(p));
+        for (std::uint64_t s = 100; s < 105; ++s) {
+            assert(f.push(Packet{s, 'B'}));
+        }
+        for (std::uint64_t s = 100; s < 107; ++s) {
+            assert(late.pop(p) && p.seq == s);
+        }
+        assert(late.duplicates() == 0 && late.lost() == 0);
+
+        // Without hold-back it starts at once; B's earlier numbers then count as a gap.
+        Gaps eager_gaps;
+        feed_t g, h;
+        rb::FeedArbiter<feed_t, decltype(seq_of), 64> first(g, h, std::chrono::nanoseconds(0), seq_of);
+        first.set_gap_callback(&Gaps::record, &eager_gaps);
+        assert(g.push(Packet{105, 'A'}) && first.pop(p) && p.seq == 105);
+        assert(h.push(Packet{103, 'B'}) && h.push(Packet{104, 'B'}) && !first.pop(p));
+        assert(first.lost() == 2 && first.duplicates() == 0 && eager_gaps.count == 2);
+        feed_t k, l;
+        rb::FeedArbiter<feed_t, decltype(seq_of), 64> configured(k, l, std::chrono::hours(1), seq_of);
+        configured.start_at(5);
+        assert(k.push(Packet{4, 'A'}) && k.push(Packet{5, 'A'}) && configured.pop(p) && p.seq == 5);
+        assert(configured.duplicates() == 1 && configured.lost() == 0); // before the configured start
+
+        // Each hole is held back from when delivery reaches it, not from an earlier hole.
+        feed_t i, j;
+        rb::FeedArbiter<feed_t, decltype(seq_of), 64> holes(i, j, std::chrono::milliseconds(100), seq_of);
+        assert(i.push(Packet{0, 'A'}) && j.push(Packet{0, 'B'}) && holes.pop(p) && p.seq == 0);
+        assert(i.push(Packet{2, 'A'}) && i.push(Packet{4, 'A'}) && !holes.pop(p)); // 1 and 3 missing
+        assert(j.push(Packet{1, 'B'}) && holes.pop(p) && p.seq == 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        assert(holes.pop(p) && p.seq == 2);
+        assert(!holes.pop(p) && holes.next_sequence() == 3 && holes.lost() == 0); // 3's hold-back just started
+    }
+
+    {
+        std::FILE* file = std::tmpfile();
+        assert(file);
+        enum class Side : std::uint8_t { buy = 1, sell = 2 };
+        {
+            rb::AsyncLogger<64, 4> logger({fileno(file), 16, std::chrono::microseconds(10)});
+            for (std::uint32_t i = 0; i < 3; ++i) {
+                while (!logger.log([] { return "fill px {} qty {} side {} ok {}"; }, 100.5, i, Side::sell, i != 1)) {
+                    std::this_thread::yield();
+                }
+            }
+            static char desk[] = "desk";
+            assert(logger.log([] { return "{} {{literal}} {} {}"; }, "venue", 'x', desk));
+            std::thread other([&] { assert(logger.log([] { return "from another thread"; })); });
+            other.join();
+        }
+        std::rewind(file);
+        std::vector<std::string> lines;
+        char buf[256];
+        while (std::fgets(buf, sizeof(buf), file)) {
+            std::string line(buf);
+            assert(line.front() == '[' && line.find("] ") != std::string::npos);
+            lines.push_back(line.substr(line.find("] ") + 2));
+        }
+        std::fclose(file);
+        assert(lines.size() == 5);
+        assert(lines[0] == "fill px 100.5 qty 0 side 2 ok true\n");
+        assert(lines[1] == "fill px 100.5 qty 1 side 2 ok false\n");
+        assert(lines[3] == "venue {literal} x desk\n" && lines[4] == "from another thread\n");
+    }
+
+#if defined(__cpp_lib_format)
+    {
+        // A width that is only known at run time can still fail on the backend.
+        std::FILE* file = std::tmpfile();
+        assert(file);
+        {
+            rb::AsyncLogger<64, 4> logger({fileno(file), 16, std::chrono::microseconds(10)});
+            assert(logger.log([] { return "w {:{}}"; }, 5, -1));
+            assert(logger.log([] { return "after {}"; }, 1));
+        }
+        std::rewind(file);
+        char buf[256];
+        assert(std::fgets(buf, sizeof(buf), file) && std::strstr(buf, "] <format error: ") && std::strstr(buf, "w {:{}}"));
+        assert(std::fgets(buf, sizeof(buf), file) && std::strstr(buf, "] after 1\n"));
+        std::fclose(file);
+    }
+#endif
+
+    {
+        struct Rec { std::uint64_t seq; std::uint64_t payload[7]; };
+        using journal_t = rb::SpscRingBuffer<Rec, 256>;
+        for (bool uring : {true, false}) {
+            std::FILE* file = std::tmpfile();
+            assert(file);
+            auto q = std::make_unique<journal_t>();
+            rb::FileSink<journal_t> sink(*q, fileno(file), {4, 1024, uring, 0, 0});
+            assert(uring || !sink.using_io_uring());
+            std::uint64_t next = 0;
+            while (next < 1000) {
+                while (next < 1000 && q->push(Rec{next, {next * 3}})) {
+                    ++next;
+                }
+                assert(sink.poll());
+            }
+            assert(sink.flush() && q->empty() && sink.bytes_written() == 1000 * sizeof(Rec));
+            std::rewind(file);
+            Rec r;
+            for (std::uint64_t i = 0; i < 1000; ++i) {
+                assert(std::fread(&r, sizeof(r), 1, file) == 1 && r.seq == i && r.payload[0] == i * 3);
+            }
+            assert(std::fread(&r, sizeof(r), 1, file) == 0);
+            std::fclose(file);
+        }
+
+        // O_DIRECT: whole blocks are written from the slots, the partial last block buffered.
+        char path[] = "/var/tmp/rb_direct_XXXXXX";
+        const int tmp = ::mkstemp(path);
+        assert(tmp >= 0);
+        ::close(tmp);
+        const int fd = ::open(path, O_RDWR | O_DIRECT);
+        for (bool uring : {true, false}) {
+            if (fd < 0) {
+                break; // file system without O_DIRECT support
+            }
+            assert(::ftruncate(fd, 0) == 0);
+            auto q = rb::numa::make_ring<journal_t>(rb::numa::Placement{});
+            assert(q);
+            {
+                rb::FileSink<journal_t> sink(*q, fd, {4, 1 << 20, uring, 4096, 0});
+                for (std::uint64_t i = 0; i < 150; ++i) { // two 4 KiB blocks and 22 records
+                    assert(q->push(Rec{i, {i * 3}}));
+                }
+                assert(sink.poll() && sink.flush() && q->empty() && sink.bytes_written() == 150 * sizeof(Rec));
+                // The partial block left the offset unaligned: the sink refuses further writes.
+                assert(q->push(Rec{150, {}}) && !sink.poll() && !sink.flush() && q->size() == 1 && sink.error() == 0);
+            }
+            assert(::lseek(fd, 0, SEEK_END) == static_cast<off_t>(150 * sizeof(Rec)));
+            const int rd = ::open(path, O_RDONLY);
+            Rec r;
+            for (std::uint64_t i = 0; i < 150; ++i) {
+                assert(::read(rd, &r, sizeof(r)) == static_cast<ssize_t>(sizeof(r)) && r.seq == i && r.payload[0] == i * 3);
+            }
+            ::close(rd);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        ::unlink(path);
+    }
+
+    {
+        struct Quote { std::uint64_t ts_ns; std::uint64_t px; };
+        char path[] = "/tmp/rb_source_XXXXXX";
+        int fd = ::mkstemp(path);
+        assert(fd >= 0);
+        for (std::uint64_t i = 0; i < 100; ++i) {
+            const Quote q{i < 99 ? 0u : 50'000'000u, 1000 + i}; // the last quote comes 50 ms later
+            assert(::write(fd, &q, sizeof(q)) == static_cast<ssize_t>(sizeof(q)));
+        }
+        assert(::write(fd, "xyz", 3) == 3); // trailing partial record is ignored
+        ::close(fd);
+
+        using quotes_t = rb::SpscRingBuffer<Quote, 16>;
+        quotes_t ring;
+        {
+            rb::FileSource<quotes_t> src(ring, path);
+            assert(src.ok() && src.size_bytes() == 100 * sizeof(Quote) + 3);
+            std::uint64_t expect = 1000;
+            Quote q;
+            while (!src.done()) {
+                src.pump(7);
+                while (ring.pop(q)) {
+                    assert(q.px == expect++);
+                }
+            }
+            assert(expect == 1100 && src.position() == 100 * sizeof(Quote));
+        }
+        {
+            rb::FileSource<quotes_t> paced(ring, path);
+            paced.pace([](const Quote& q) noexcept { return q.ts_ns; });
+            Quote q;
+            std::size_t got = 0;
+            while (got < 99) {
+                paced.pump();
+                while (ring.pop(q)) {
+                    ++got;
+                }
+            }
+            assert(paced.pump() == 0 && !paced.done()); // not due for another 50 ms
+            std::this_thread::sleep_for(std::chrono::milliseconds(60));
+            assert(paced.pump() == 1 && ring.pop(q) && q.px == 1099 && paced.done());
+        }
+
+        fd = ::open(path, O_WRONLY | O_TRUNC);
+        for (const char* payload : {"a", "bcd", ""}) {
+            const auto n = static_cast<std::uint32_t>(std::strlen(payload));
+            assert(::write(fd, &n, sizeof(n)) == 4 && ::write(fd, payload, n) == static_cast<ssize_t>(n));
+        }
+        const std::uint32_t cut = 10;
+        assert(::write(fd, &cut, sizeof(cut)) == 4 && ::write(fd, "short", 5) == 5);
+        ::close(fd);
+        using views_t = rb::SpscRingBuffer<rb::RecordView, 8>;
+        views_t views;
+        rb::FileSource<views_t, rb::LengthPrefixed<>> framed(views, path);
+        assert(framed.pump() == 3 && framed.done());
+        rb::RecordView v;
+        assert(views.pop(v) && v.size == 1 && v.data[0] == 'a');
+        assert(views.pop(v) && v.size == 3 && std::memcmp(v.data, "bcd", 3) == 0);
+        assert(views.pop(v) && v.size == 0 && views.empty());
+        ::unlink(path);
+    }
+
+    {
+        rb::TraceRecorder rec(16);
+        for (std::uint32_t i = 0; i < 5; ++i) {
+            rec.record(64 + i);
+        }
+        const rb::Trace recorded = rec.trace();
+        assert(recorded.size() == 5 && recorded.events()[0].gap_ns == 0 && recorded.events()[4].size == 68);
+
+        rb::Trace synthetic;
+        synthetic.append(0, 32);
+        synthetic.append(300, 0xFFFFFFFFu);
+        synthetic.append(std::uint64_t{1} << 40, 1);
+        synthetic.append(2'000'000, 128);
+        char path[] = "/tmp/rb_trace_XXXXXX";
+        const int fd = ::mkstemp(path);
+        assert(fd >= 0);
+        ::close(fd);
+        assert(synthetic.save(path));
+        rb::Trace loaded;
+        assert(loaded.load(path) && loaded.size() == 4 && loaded.duration_ns() == synthetic.duration_ns());
+        assert(loaded.events()[1].size == 0xFFFFFFFFu && loaded.events()[2].gap_ns == std::uint64_t{1} << 40);
+        std::FILE* f = std::fopen(path, "r+b");
+        assert(f && std::fseek(f, -1, SEEK_END) == 0 && std::fputc(0x80, f) == 0x80 && std::fclose(f) == 0);
+        assert(!loaded.load(path) && loaded.size() == 4); // truncated varint: rejected, contents kept
+        ::unlink(path);
+
+        rb::Trace burst;
+        for (int i = 0; i < 10; ++i) {
+            burst.append(i == 5 ? 2'000'000 : 100, 16);
+        }
+        rb::SpscRingBuffer<std::uint32_t, 16> q;
+        const auto t0 = std::chrono::steady_clock::now();
+        const auto stats = rb::replay(burst, [&](const rb::TraceEvent& e) { assert(q.push(e.size)); });
+        assert(stats.events == 10 && q.size() == 10);
+        assert(std::chrono::steady_clock::now() - t0 >= std::chrono::microseconds(2000));
+    }
     return 0;
 }